@@ -0,0 +1,177 @@
+#include "async_query_executor.h"
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+
+using namespace std::string_literals;
+
+AsyncQueryExecutor::AsyncQueryExecutor(const SearchServer& search_server, size_t thread_count, size_t max_queue_size, size_t max_batch_size)
+	: search_server_(search_server),
+	max_queue_size_(std::max<size_t>(max_queue_size, 1)),
+	max_batch_size_(std::max<size_t>(max_batch_size, 1))
+{
+	thread_count = std::max<size_t>(thread_count, 1);
+	for (size_t i = 0; i < thread_count; ++i)
+	{
+		workers_.emplace_back([this] { RunWorker(); });
+	}
+}
+
+AsyncQueryExecutor::~AsyncQueryExecutor()
+{
+	{
+		std::lock_guard lock(mutex_);
+		is_stopping_ = true;
+	}
+	queue_not_empty_.notify_all();
+	queue_not_full_.notify_all();
+	for (std::thread& worker : workers_)
+	{
+		worker.join();
+	}
+}
+
+std::optional<std::future<std::vector<Document>>> AsyncQueryExecutor::TrySubmit(std::string raw_query, DocumentStatus status, size_t max_result_count)
+{
+	std::unique_lock lock(mutex_);
+	if (is_stopping_ || queue_.size() >= max_queue_size_)
+	{
+		return std::nullopt;
+	}
+	auto future = Enqueue(std::move(raw_query), status, max_result_count);
+	lock.unlock();
+	queue_not_empty_.notify_one();
+	return future;
+}
+
+std::future<std::vector<Document>> AsyncQueryExecutor::Submit(std::string raw_query, DocumentStatus status, size_t max_result_count)
+{
+	std::unique_lock lock(mutex_);
+	queue_not_full_.wait(lock, [this]
+		{
+			return is_stopping_ || queue_.size() < max_queue_size_;
+		});
+	if (is_stopping_)
+	{
+		throw std::runtime_error("The executor is stopping"s);
+	}
+	auto future = Enqueue(std::move(raw_query), status, max_result_count);
+	lock.unlock();
+	queue_not_empty_.notify_one();
+	return future;
+}
+
+size_t AsyncQueryExecutor::GetQueueSize() const
+{
+	std::lock_guard lock(mutex_);
+	return queue_.size();
+}
+
+size_t AsyncQueryExecutor::GetSharedResultCount() const
+{
+	std::lock_guard lock(mutex_);
+	return shared_result_count_;
+}
+
+std::future<std::vector<Document>> AsyncQueryExecutor::Enqueue(std::string raw_query, DocumentStatus status, size_t max_result_count)
+{
+	Request& request = queue_.emplace_back();
+	request.raw_query = std::move(raw_query);
+	request.status = status;
+	request.max_result_count = max_result_count;
+	return request.promise.get_future();
+}
+
+void AsyncQueryExecutor::RunWorker()
+{
+	std::vector<Request> batch;
+	batch.reserve(max_batch_size_);
+	while (true)
+	{
+		{
+			std::unique_lock lock(mutex_);
+			queue_not_empty_.wait(lock, [this]
+				{
+					return is_stopping_ || !queue_.empty();
+				});
+			if (queue_.empty())
+			{
+				return; // Stopping, and every admitted query is taken
+			}
+			const size_t batch_size = std::min(queue_.size(), max_batch_size_);
+			std::move(queue_.begin(), queue_.begin() + batch_size, std::back_inserter(batch));
+			queue_.erase(queue_.begin(), queue_.begin() + batch_size);
+		}
+		queue_not_full_.notify_all();
+		RunBatch(batch);
+		batch.clear();
+	}
+}
+
+void AsyncQueryExecutor::RunBatch(std::vector<Request>& batch)
+{
+	// Queries are parsed first, a query that fails it gets the exception and leaves the batch
+	struct PreparedRequest
+	{
+		SearchServer::PreparedQuery query;
+		Request* request;
+	};
+	std::vector<PreparedRequest> prepared_requests;
+	prepared_requests.reserve(batch.size());
+	for (Request& request : batch)
+	{
+		try
+		{
+			prepared_requests.push_back({ search_server_.PrepareQuery(request.raw_query), &request });
+		}
+		catch (...)
+		{
+			request.promise.set_exception(std::current_exception());
+		}
+	}
+
+	// Sorted by the key of the search, so duplicate requests are neighbours and only the first of them is searched
+	const auto get_key = [](const PreparedRequest& prepared_request)
+	{
+		return std::tie(prepared_request.query.GetPlusWords(), prepared_request.query.GetMinusWords(), prepared_request.request->status, prepared_request.request->max_result_count);
+	};
+	std::sort(prepared_requests.begin(), prepared_requests.end(), [&get_key](const PreparedRequest& lhs, const PreparedRequest& rhs)
+		{
+			return get_key(lhs) < get_key(rhs);
+		});
+	std::vector<Document> documents;
+	std::exception_ptr exception;
+	size_t shared_result_count = 0;
+	for (size_t i = 0; i < prepared_requests.size(); ++i)
+	{
+		Request& request = *prepared_requests[i].request;
+		if (i == 0 || get_key(prepared_requests[i]) != get_key(prepared_requests[i - 1]))
+		{
+			exception = nullptr;
+			try
+			{
+				documents = search_server_.FindTopDocuments(prepared_requests[i].query, request.status, request.max_result_count);
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+		}
+		else
+		{
+			++shared_result_count;
+		}
+		if (exception)
+		{
+			request.promise.set_exception(exception);
+		}
+		else
+		{
+			request.promise.set_value(documents);
+		}
+	}
+	std::lock_guard lock(mutex_);
+	shared_result_count_ += shared_result_count;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "search_server.h"
+#include "document.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves FindTopDocuments to callers that must not block: a query is admitted into a bounded queue and its documents come in a future.
+// Workers take up to max_batch_size queued queries at once and coalesce duplicates: requests of the batch with the same words,
+// status and result count are answered by one search. Queries that only share some words are searched separately.
+// The server must not change while the executor is alive, take a snapshot of SnapshotSearchServer to keep serving during changes
+class AsyncQueryExecutor
+{
+public:
+	AsyncQueryExecutor(const SearchServer& search_server, size_t thread_count, size_t max_queue_size, size_t max_batch_size = default_max_batch_size_);
+	~AsyncQueryExecutor(); // Stops admitting queries, finishes the admitted ones and stops the workers
+	AsyncQueryExecutor(const AsyncQueryExecutor&) = delete;
+	AsyncQueryExecutor& operator=(const AsyncQueryExecutor&) = delete;
+
+	// Returns std::nullopt at once if the queue is full or the executor is stopping, so the caller can shed load. An invalid query fails its future
+	std::optional<std::future<std::vector<Document>>> TrySubmit(std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+	// Waits for room in the queue, throws std::runtime_error if the executor starts stopping meanwhile
+	std::future<std::vector<Document>> Submit(std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+	size_t GetQueueSize() const;
+	size_t GetSharedResultCount() const; // Requests answered by a search made for another request of the same batch
+
+private:
+	struct Request
+	{
+		std::string raw_query;
+		DocumentStatus status;
+		size_t max_result_count;
+		std::promise<std::vector<Document>> promise;
+	};
+
+	static constexpr size_t default_max_batch_size_ = 16;
+
+	const SearchServer& search_server_;
+	const size_t max_queue_size_;
+	const size_t max_batch_size_;
+	mutable std::mutex mutex_; // Guards the queue and the counters
+	std::condition_variable queue_not_empty_;
+	std::condition_variable queue_not_full_;
+	std::deque<Request> queue_;
+	size_t shared_result_count_ = 0;
+	bool is_stopping_ = false;
+	std::vector<std::thread> workers_; // Started last, as they use all the members above
+
+	std::future<std::vector<Document>> Enqueue(std::string raw_query, DocumentStatus status, size_t max_result_count); // mutex_ must be held
+	void RunWorker();
+	void RunBatch(std::vector<Request>& batch);
+};
\ No newline at end of file
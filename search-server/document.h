@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <iostream>
 #include <string>
 
@@ -10,6 +11,8 @@ enum class DocumentStatus
 	REMOVED,
 };
 
+constexpr size_t DOCUMENT_STATUS_COUNT = 4;
+
 struct Document
 {
 	Document() = default;
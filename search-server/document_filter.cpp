@@ -0,0 +1,6 @@
+#include "document_filter.h"
+
+bool DocumentFilter::operator()(int, DocumentStatus status, int rating) const
+{
+	return statuses.test(static_cast<size_t>(status)) && rating >= min_rating && rating <= max_rating;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+#include "document.h"
+#include <bitset>
+#include <limits>
+
+using StatusSet = std::bitset<DOCUMENT_STATUS_COUNT>; // Bit i is set for static_cast<DocumentStatus>(i)
+
+// Declarative alternative to a document predicate: documents with one of the statuses and a rating in [min_rating, max_rating].
+// Unlike a lambda the search server can see what it selects, so it looks the documents up in its rating index before scoring
+struct DocumentFilter
+{
+	StatusSet statuses = StatusSet().set();
+	int min_rating = std::numeric_limits<int>::min();
+	int max_rating = std::numeric_limits<int>::max();
+
+	bool operator()(int document_id, DocumentStatus status, int rating) const; // Same check as a predicate
+};
\ No newline at end of file
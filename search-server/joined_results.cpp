@@ -0,0 +1,66 @@
+#include "joined_results.h"
+#include <algorithm>
+#include <stdexcept>
+
+JoinedResults::JoinedResults(size_t query_count, size_t max_result_count)
+	: max_result_count_(max_result_count),
+	documents_(query_count * max_result_count),
+	offsets_(query_count + 1)
+{
+}
+
+void JoinedResults::Write(size_t query_index, const std::vector<Document>& documents)
+{
+	if (documents.size() > max_result_count_)
+	{
+		throw std::length_error("Too many documents for the slice of a query");
+	}
+	std::copy(documents.begin(), documents.end(), documents_.begin() + query_index * max_result_count_);
+	offsets_[query_index + 1] = documents.size();
+}
+
+void JoinedResults::Join()
+{
+	// Slices only move towards the front, so one pass packs them in place. A slice that stays where it is is not moved,
+	// as the destination of std::move must not be inside its source
+	for (size_t query_index = 0; query_index + 1 < offsets_.size(); ++query_index)
+	{
+		const size_t slice_begin = query_index * max_result_count_;
+		if (offsets_[query_index] != slice_begin)
+		{
+			std::move(documents_.begin() + slice_begin, documents_.begin() + slice_begin + offsets_[query_index + 1], documents_.begin() + offsets_[query_index]);
+		}
+		offsets_[query_index + 1] += offsets_[query_index];
+	}
+	documents_.resize(offsets_.back());
+}
+
+JoinedResults::const_iterator JoinedResults::begin() const
+{
+	return documents_.begin();
+}
+
+JoinedResults::const_iterator JoinedResults::end() const
+{
+	return documents_.end();
+}
+
+size_t JoinedResults::size() const
+{
+	return documents_.size();
+}
+
+bool JoinedResults::empty() const
+{
+	return documents_.empty();
+}
+
+size_t JoinedResults::GetQueryCount() const
+{
+	return offsets_.empty() ? 0 : offsets_.size() - 1;
+}
+
+IteratorRange<JoinedResults::const_iterator> JoinedResults::GetQueryDocuments(size_t query_index) const
+{
+	return { documents_.begin() + offsets_.at(query_index), documents_.begin() + offsets_.at(query_index + 1) };
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "document.h"
+#include "paginator.h"
+#include <cstddef>
+#include <vector>
+
+// Results of a batch of queries in one contiguous array, the documents of each query follow those of the previous one.
+// Every query gets a slice of max_result_count documents up front, so queries are written in parallel and in any order
+// without allocating, then Join closes the gaps between the slices
+class JoinedResults
+{
+public:
+	using const_iterator = std::vector<Document>::const_iterator;
+
+	JoinedResults() = default;
+	JoinedResults(size_t query_count, size_t max_result_count);
+
+	// Writing, each query once and before Join. Different queries may be written from different threads
+	void Write(size_t query_index, const std::vector<Document>& documents); // At most max_result_count documents
+	void Join();
+
+	// Reading, after Join
+	const_iterator begin() const;
+	const_iterator end() const;
+	size_t size() const;
+	bool empty() const;
+	size_t GetQueryCount() const;
+	IteratorRange<const_iterator> GetQueryDocuments(size_t query_index) const;
+
+private:
+	size_t max_result_count_ = 0;
+	std::vector<Document> documents_;
+	std::vector<size_t> offsets_; // [query index]: where its documents begin, the last one is the end. Before Join: document counts from index 1
+};
\ No newline at end of file
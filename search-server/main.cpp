@@ -1,6 +1,9 @@
 #include "remove_document_benchmark.h"
 #include "parallel_search_benchmark.h"
 #include "match_document_benchmark.h"
+#include "posting_list_benchmark.h"
+#include "top_k_search_benchmark.h"
+#include "snapshot_search_benchmark.h"
 #include "test_example_functions.h"
 #include "remove_duplicates.h"
 #include "process_queries.h"
@@ -307,6 +310,9 @@ int main()
 
 	ParallelSearchBenchmark();
 	ParallelJoinedSearchBenchmark();
+	CompressedPostingsBenchmark();
+	TopKSearchBenchmark();
+	SnapshotSearchBenchmark();
 
 	//{
 	//	SearchServer search_server("and with"s);
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "process_queries.h"
+#include "query_executor.h"
 #include "log_duration.h"
 
 #define PAR_SEARCH_BENCHMARK(processor) ParallelSearchQueries(#processor, processor, search_server, queries)
@@ -84,6 +85,17 @@ void ParallelSearchBenchmark()
 	}
 	const auto queries = GenerateQueriesParallelSearch(generator, dictionary, 2'000, 7);
 	PAR_SEARCH_BENCHMARK(ProcessQueries);
+
+	QueryExecutor query_executor;
+	query_executor.ProcessQueries(search_server, queries); // Warms up the scratch of the workers
+	ParallelSearchQueries("QueryExecutor"s, [&query_executor](const SearchServer& search_server, const std::vector<std::string>& queries)
+		{
+			return query_executor.ProcessQueries(search_server, queries);
+		}, search_server, queries);
+	const QueryExecutor::BatchStatistics statistics = query_executor.GetLastBatchStatistics();
+	cout << "Query executor: "s << statistics.task_count << " queries in "s << statistics.seconds * 1000 << " ms, "s
+		<< static_cast<int64_t>(statistics.GetThroughput()) << " queries/s, "s << statistics.stolen_task_count << " stolen on "s
+		<< query_executor.GetThreadCount() << " threads"s << endl;
 }
 
 void ParallelJoinedSearchBenchmark()
@@ -0,0 +1,454 @@
+#include "posting_list.h"
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+	void WriteVarint(uint32_t value, std::vector<uint8_t>& output)
+	{
+		// 7 bits per byte, the high bit tells that more bytes follow
+		while (value >= 0x80)
+		{
+			output.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		output.push_back(static_cast<uint8_t>(value));
+	}
+
+	uint32_t ReadVarint(const uint8_t*& data)
+	{
+		uint32_t value = 0;
+		int shift = 0;
+		while (*data & 0x80)
+		{
+			value |= static_cast<uint32_t>(*data++ & 0x7F) << shift;
+			shift += 7;
+		}
+		value |= static_cast<uint32_t>(*data++) << shift;
+		return value;
+	}
+}
+
+void PostingList::Add(int document_id, uint32_t term_count, double term_freq)
+{
+	// New IDs are usually the largest ones, then the buffer stays sorted by a plain push_back
+	const auto it = std::lower_bound(buffer_document_ids_.begin(), buffer_document_ids_.end(), document_id);
+	const auto pos = std::distance(buffer_document_ids_.begin(), it);
+	buffer_document_ids_.insert(it, document_id);
+	buffer_term_counts_.insert(buffer_term_counts_.begin() + pos, term_count);
+	buffer_max_term_freq_ = std::max(buffer_max_term_freq_, term_freq);
+	max_term_freq_ = std::max(max_term_freq_, term_freq);
+	++size_;
+
+	// Appends after the last block are compressed as soon as a block is filled, inserts in the middle are batched
+	const bool appends_only = blocks_.empty() || buffer_document_ids_.front() > blocks_.back().last_document_id;
+	if (buffer_document_ids_.size() >= (appends_only ? block_size_ : std::max(block_size_, size_ / main_to_buffer_ratio_)))
+	{
+		MergeBuffer();
+	}
+}
+
+bool PostingList::Erase(int document_id)
+{
+	const auto it = std::lower_bound(buffer_document_ids_.begin(), buffer_document_ids_.end(), document_id);
+	if (it != buffer_document_ids_.end() && *it == document_id)
+	{
+		buffer_term_counts_.erase(buffer_term_counts_.begin() + std::distance(buffer_document_ids_.begin(), it));
+		buffer_document_ids_.erase(it);
+		--size_;
+		return true;
+	}
+
+	const size_t block_index = FindBlock(document_id);
+	if (block_index == blocks_.size())
+	{
+		return false;
+	}
+	int document_ids[block_size_];
+	uint32_t term_counts[block_size_];
+	DecodeBlock(block_index, document_ids, term_counts);
+	BlockHeader& block = blocks_[block_index];
+	const auto pos = std::lower_bound(document_ids, document_ids + block.size, document_id) - document_ids;
+	if (pos == block.size || document_ids[pos] != document_id)
+	{
+		return false;
+	}
+	std::copy(document_ids + pos + 1, document_ids + block.size, document_ids + pos);
+	std::copy(term_counts + pos + 1, term_counts + block.size, term_counts + pos);
+	--block.size;
+	--size_;
+
+	// Only this block is re-encoded, the bytes after it are shifted and their offsets corrected
+	std::vector<uint8_t> block_bytes;
+	EncodeBlock(document_ids, term_counts, block.size, block_bytes);
+	const size_t old_begin = block.offset;
+	const size_t old_end = GetBlockEnd(block_index);
+	encoded_.erase(encoded_.begin() + old_begin, encoded_.begin() + old_end);
+	encoded_.insert(encoded_.begin() + old_begin, block_bytes.begin(), block_bytes.end());
+	const int64_t offset_shift = static_cast<int64_t>(block_bytes.size()) - static_cast<int64_t>(old_end - old_begin);
+	for (size_t i = block_index + 1; i < blocks_.size(); ++i)
+	{
+		blocks_[i].offset = static_cast<uint32_t>(blocks_[i].offset + offset_shift);
+	}
+
+	if (block.size == 0)
+	{
+		blocks_.erase(blocks_.begin() + block_index);
+	}
+	else
+	{
+		block.first_document_id = document_ids[0];
+		block.last_document_id = document_ids[block.size - 1];
+	}
+	return true;
+}
+
+size_t PostingList::EraseMarked(const std::vector<bool>& is_erased)
+{
+	const auto is_marked = [&is_erased](int document_id)
+	{
+		return static_cast<size_t>(document_id) < is_erased.size() && is_erased[document_id];
+	};
+	const size_t old_size = size_;
+
+	size_t kept_count = 0;
+	for (size_t i = 0; i < buffer_document_ids_.size(); ++i)
+	{
+		if (!is_marked(buffer_document_ids_[i]))
+		{
+			buffer_document_ids_[kept_count] = buffer_document_ids_[i];
+			buffer_term_counts_[kept_count] = buffer_term_counts_[i];
+			++kept_count;
+		}
+	}
+	size_ -= buffer_document_ids_.size() - kept_count;
+	buffer_document_ids_.resize(kept_count);
+	buffer_term_counts_.resize(kept_count);
+
+	// Blocks are written anew one after another, a block without marked postings is copied as it is encoded
+	std::vector<BlockHeader> blocks;
+	std::vector<uint8_t> encoded;
+	blocks.reserve(blocks_.size());
+	encoded.reserve(encoded_.size());
+	int document_ids[block_size_];
+	uint32_t term_counts[block_size_];
+	for (size_t block_index = 0; block_index < blocks_.size(); ++block_index)
+	{
+		BlockHeader block = blocks_[block_index];
+		DecodeBlock(block_index, document_ids, term_counts);
+		kept_count = 0;
+		for (size_t i = 0; i < block.size; ++i)
+		{
+			if (!is_marked(document_ids[i]))
+			{
+				document_ids[kept_count] = document_ids[i];
+				term_counts[kept_count] = term_counts[i];
+				++kept_count;
+			}
+		}
+		size_ -= block.size - kept_count;
+		if (kept_count == 0)
+		{
+			continue;
+		}
+		const size_t old_begin = block.offset;
+		block.offset = static_cast<uint32_t>(encoded.size());
+		if (kept_count == block.size)
+		{
+			encoded.insert(encoded.end(), encoded_.begin() + old_begin, encoded_.begin() + GetBlockEnd(block_index));
+		}
+		else
+		{
+			block.size = static_cast<uint32_t>(kept_count);
+			block.first_document_id = document_ids[0];
+			block.last_document_id = document_ids[kept_count - 1];
+			EncodeBlock(document_ids, term_counts, kept_count, encoded);
+		}
+		blocks.push_back(block);
+	}
+	blocks_ = std::move(blocks);
+	encoded_ = std::move(encoded);
+	return old_size - size_;
+}
+
+bool PostingList::Contains(int document_id) const
+{
+	if (std::binary_search(buffer_document_ids_.begin(), buffer_document_ids_.end(), document_id))
+	{
+		return true;
+	}
+	const size_t block_index = FindBlock(document_id);
+	if (block_index == blocks_.size())
+	{
+		return false;
+	}
+	// Decoding stops as soon as the gaps pass the wanted ID
+	const BlockHeader& block = blocks_[block_index];
+	const uint8_t* data = encoded_.data() + block.offset;
+	int current_id = block.first_document_id;
+	for (size_t i = 0; i < block.size && current_id <= document_id; ++i)
+	{
+		if (i > 0)
+		{
+			current_id += static_cast<int>(ReadVarint(data));
+		}
+		if (current_id == document_id)
+		{
+			return true;
+		}
+		ReadVarint(data);
+	}
+	return false;
+}
+
+size_t PostingList::Size() const
+{
+	return size_;
+}
+
+bool PostingList::Empty() const
+{
+	return size_ == 0;
+}
+
+double PostingList::GetMaxTermFreq() const
+{
+	return max_term_freq_;
+}
+
+size_t PostingList::GetMemoryUsage() const
+{
+	return sizeof(PostingList)
+		+ blocks_.capacity() * sizeof(BlockHeader)
+		+ encoded_.capacity() * sizeof(uint8_t)
+		+ buffer_document_ids_.capacity() * sizeof(int)
+		+ buffer_term_counts_.capacity() * sizeof(uint32_t);
+}
+
+size_t PostingList::GetBlockEnd(size_t block_index) const
+{
+	return block_index + 1 < blocks_.size() ? blocks_[block_index + 1].offset : encoded_.size();
+}
+
+size_t PostingList::FindBlock(int document_id) const
+{
+	const auto it = std::lower_bound(blocks_.begin(), blocks_.end(), document_id, [](const BlockHeader& block, int id)
+		{
+			return block.last_document_id < id;
+		});
+	if (it == blocks_.end() || it->first_document_id > document_id)
+	{
+		return blocks_.size();
+	}
+	return std::distance(blocks_.begin(), it);
+}
+
+void PostingList::DecodeBlock(size_t block_index, int* document_ids, uint32_t* term_counts) const
+{
+	const BlockHeader& block = blocks_[block_index];
+	const uint8_t* data = encoded_.data() + block.offset;
+	int document_id = block.first_document_id;
+	// Dense lists have gaps and term counts below 128, then every value is one byte and the block is read without branches
+	if (GetBlockEnd(block_index) - block.offset == 2 * block.size - 1)
+	{
+		document_ids[0] = document_id;
+		term_counts[0] = data[0];
+		for (size_t i = 1; i < block.size; ++i)
+		{
+			document_id += data[2 * i - 1];
+			document_ids[i] = document_id;
+			term_counts[i] = data[2 * i];
+		}
+		return;
+	}
+	for (size_t i = 0; i < block.size; ++i)
+	{
+		if (i > 0)
+		{
+			document_id += static_cast<int>(ReadVarint(data));
+		}
+		document_ids[i] = document_id;
+		term_counts[i] = ReadVarint(data);
+	}
+}
+
+void PostingList::EncodeBlock(const int* document_ids, const uint32_t* term_counts, size_t count, std::vector<uint8_t>& output)
+{
+	// The first ID is kept in the block header, the others are stored as gaps from the previous one
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i > 0)
+		{
+			WriteVarint(static_cast<uint32_t>(document_ids[i] - document_ids[i - 1]), output);
+		}
+		WriteVarint(term_counts[i], output);
+	}
+}
+
+void PostingList::MergeBuffer()
+{
+	// Blocks ordered before the first buffered ID stay as they are, the rest is decoded and re-encoded together with the buffer.
+	// For in-order appends that is at most the last, partially filled block
+	const int first_buffered_id = buffer_document_ids_.front();
+	size_t first_block = std::distance(blocks_.begin(), std::lower_bound(blocks_.begin(), blocks_.end(), first_buffered_id, [](const BlockHeader& block, int id)
+		{
+			return block.last_document_id < id;
+		}));
+	if (first_block == blocks_.size() && !blocks_.empty() && blocks_.back().size < block_size_)
+	{
+		--first_block;
+	}
+
+	// TF of single postings is not stored, so each one carries the bound of the block or the buffer it came from
+	std::vector<int> document_ids;
+	std::vector<uint32_t> term_counts;
+	std::vector<double> max_term_freqs;
+	int block_document_ids[block_size_];
+	uint32_t block_term_counts[block_size_];
+	size_t buffer_pos = 0;
+	for (size_t block_index = first_block; block_index < blocks_.size(); ++block_index)
+	{
+		DecodeBlock(block_index, block_document_ids, block_term_counts);
+		for (size_t i = 0; i < blocks_[block_index].size; ++i)
+		{
+			for (; buffer_pos < buffer_document_ids_.size() && buffer_document_ids_[buffer_pos] < block_document_ids[i]; ++buffer_pos)
+			{
+				document_ids.push_back(buffer_document_ids_[buffer_pos]);
+				term_counts.push_back(buffer_term_counts_[buffer_pos]);
+				max_term_freqs.push_back(buffer_max_term_freq_);
+			}
+			document_ids.push_back(block_document_ids[i]);
+			term_counts.push_back(block_term_counts[i]);
+			max_term_freqs.push_back(blocks_[block_index].max_term_freq);
+		}
+	}
+	document_ids.insert(document_ids.end(), buffer_document_ids_.begin() + buffer_pos, buffer_document_ids_.end());
+	term_counts.insert(term_counts.end(), buffer_term_counts_.begin() + buffer_pos, buffer_term_counts_.end());
+	max_term_freqs.resize(document_ids.size(), buffer_max_term_freq_);
+
+	encoded_.resize(first_block < blocks_.size() ? blocks_[first_block].offset : encoded_.size());
+	blocks_.resize(first_block);
+	for (size_t begin = 0; begin < document_ids.size(); begin += block_size_)
+	{
+		const size_t count = std::min(block_size_, document_ids.size() - begin);
+		BlockHeader block;
+		block.first_document_id = document_ids[begin];
+		block.last_document_id = document_ids[begin + count - 1];
+		block.offset = static_cast<uint32_t>(encoded_.size());
+		block.size = static_cast<uint32_t>(count);
+		block.max_term_freq = *std::max_element(max_term_freqs.begin() + begin, max_term_freqs.begin() + begin + count);
+		EncodeBlock(document_ids.data() + begin, term_counts.data() + begin, count, encoded_);
+		blocks_.push_back(block);
+	}
+	buffer_document_ids_.clear();
+	buffer_term_counts_.clear();
+	buffer_max_term_freq_ = 0.0;
+}
+
+void PostingList::ShrinkToFit()
+{
+	if (!buffer_document_ids_.empty())
+	{
+		MergeBuffer();
+	}
+	blocks_.shrink_to_fit();
+	encoded_.shrink_to_fit();
+	buffer_document_ids_.shrink_to_fit();
+	buffer_term_counts_.shrink_to_fit();
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+	: postings_(&postings)
+{
+	LoadBlock(0);
+	Settle();
+}
+
+void PostingList::Cursor::Next()
+{
+	if (in_buffer_)
+	{
+		++buffer_pos_;
+	}
+	else if (++block_pos_ == postings_->blocks_[block_index_].size)
+	{
+		LoadBlock(block_index_ + 1);
+	}
+	Settle();
+}
+
+void PostingList::Cursor::NextGeq(int document_id)
+{
+	if (document_id <= document_id_)
+	{
+		return;
+	}
+	const std::vector<int>& buffer_document_ids = postings_->buffer_document_ids_;
+	buffer_pos_ = std::distance(buffer_document_ids.begin(), std::lower_bound(buffer_document_ids.begin() + buffer_pos_, buffer_document_ids.end(), document_id));
+
+	const std::vector<BlockHeader>& blocks = postings_->blocks_;
+	if (!IsBlockEnd() && blocks[block_index_].last_document_id < document_id)
+	{
+		// Blocks ending before the wanted ID are skipped by their headers
+		const auto it = std::lower_bound(blocks.begin() + block_index_ + 1, blocks.end(), document_id, [](const BlockHeader& block, int id)
+			{
+				return block.last_document_id < id;
+			});
+		LoadBlock(std::distance(blocks.begin(), it));
+	}
+	if (!IsBlockEnd())
+	{
+		block_pos_ = std::distance(document_ids_, std::lower_bound(document_ids_ + block_pos_, document_ids_ + blocks[block_index_].size, document_id));
+	}
+	Settle();
+}
+
+double PostingList::Cursor::GetBlockMaxTermFreq(int document_id, int& region_end) const
+{
+	double max_term_freq = 0.0;
+	region_end = end_document_id;
+	const std::vector<BlockHeader>& blocks = postings_->blocks_;
+	auto it = blocks.begin() + block_index_;
+	if (it != blocks.end() && it->last_document_id < document_id)
+	{
+		it = std::lower_bound(it + 1, blocks.end(), document_id, [](const BlockHeader& block, int id)
+			{
+				return block.last_document_id < id;
+			});
+	}
+	if (it != blocks.end())
+	{
+		max_term_freq = it->max_term_freq;
+		region_end = it->last_document_id;
+	}
+	const std::vector<int>& buffer_document_ids = postings_->buffer_document_ids_;
+	if (buffer_pos_ < buffer_document_ids.size() && buffer_document_ids.back() >= document_id)
+	{
+		max_term_freq = std::max(max_term_freq, postings_->buffer_max_term_freq_);
+	}
+	return max_term_freq;
+}
+
+bool PostingList::Cursor::IsBlockEnd() const
+{
+	return block_index_ == postings_->blocks_.size();
+}
+
+void PostingList::Cursor::LoadBlock(size_t block_index)
+{
+	block_index_ = block_index;
+	block_pos_ = 0;
+	if (!IsBlockEnd())
+	{
+		postings_->DecodeBlock(block_index_, document_ids_, term_counts_);
+	}
+}
+
+void PostingList::Cursor::Settle()
+{
+	const std::vector<int>& buffer_document_ids = postings_->buffer_document_ids_;
+	const int block_document_id = IsBlockEnd() ? end_document_id : document_ids_[block_pos_];
+	const int buffer_document_id = buffer_pos_ == buffer_document_ids.size() ? end_document_id : buffer_document_ids[buffer_pos_];
+	in_buffer_ = buffer_document_id < block_document_id;
+	document_id_ = std::min(block_document_id, buffer_document_id);
+}
\ No newline at end of file
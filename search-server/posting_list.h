@@ -0,0 +1,146 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <vector>
+
+// Postings of one term: IDs of documents containing it and how many times the term occurs in them.
+// The main part is split into blocks of up to 128 postings sorted by document ID. Inside a block IDs are stored
+// as variable-byte deltas and term counts as variable-byte integers, so a posting usually takes 2-3 bytes.
+// A block where every value takes one byte is decoded by a loop without branches.
+// New documents go to a small sorted append buffer which is compressed into blocks once it grows.
+// Every block and the buffer keep an upper bound of Term Frequency of their postings for dynamic pruning
+class PostingList
+{
+public:
+	static constexpr size_t block_size_ = 128;
+
+	class Cursor;
+
+	// The document must not be in the list yet, term_freq is only used for the upper bounds
+	void Add(int document_id, uint32_t term_count, double term_freq);
+	bool Erase(int document_id); // Returns false if the document is not in the list, the upper bounds are left as they are
+	// Erases the postings of all documents marked in the bitmap in one pass and returns how many there were.
+	// Only blocks losing postings are re-encoded, the upper bounds are left as they are
+	size_t EraseMarked(const std::vector<bool>& is_erased);
+
+	bool Contains(int document_id) const;
+	size_t Size() const;
+	bool Empty() const;
+	size_t GetMemoryUsage() const; // Bytes taken by the blocks, their headers and the append buffer
+	double GetMaxTermFreq() const; // Upper bound of Term Frequency over the whole list
+	void ShrinkToFit(); // Compresses the append buffer into blocks and releases spare memory, for a list that is not going to change
+
+	template <typename Function>
+	void ForEach(Function function) const; // Calls function(document_id, term_count) in ascending order of document IDs, decoding block by block
+
+private:
+	static constexpr size_t main_to_buffer_ratio_ = 8; // Out-of-order buffer is compressed when it reaches 1/8 of the list
+
+	struct BlockHeader
+	{
+		int first_document_id = 0;
+		int last_document_id = 0;
+		uint32_t offset = 0; // Position of the block in encoded_
+		uint32_t size = 0; // Number of postings in the block
+		double max_term_freq = 0.0; // Upper bound of Term Frequency in the block
+	};
+
+	std::vector<BlockHeader> blocks_;
+	std::vector<uint8_t> encoded_;
+	std::vector<int> buffer_document_ids_;
+	std::vector<uint32_t> buffer_term_counts_;
+	double buffer_max_term_freq_ = 0.0;
+	double max_term_freq_ = 0.0;
+	size_t size_ = 0;
+
+	size_t GetBlockEnd(size_t block_index) const; // Position in encoded_ right after the block
+	size_t FindBlock(int document_id) const; // Index of the block whose ID range covers the document, blocks_.size() if none
+	void DecodeBlock(size_t block_index, int* document_ids, uint32_t* term_counts) const;
+	static void EncodeBlock(const int* document_ids, const uint32_t* term_counts, size_t count, std::vector<uint8_t>& output);
+	void MergeBuffer();
+};
+
+// Walks a posting list in ascending order of document IDs and skips whole blocks without decoding them.
+// The list must not change while the cursor is used
+class PostingList::Cursor
+{
+public:
+	static constexpr int end_document_id = INT_MAX; // Returned by GetDocumentId once the postings are over
+
+	explicit Cursor(const PostingList& postings);
+
+	bool IsEnd() const;
+	int GetDocumentId() const;
+	uint32_t GetTermCount() const;
+	void Next();
+	void NextGeq(int document_id); // Moves to the first posting with ID not less than document_id
+
+	// Upper bound of Term Frequency of postings with IDs from document_id to region_end, taken from the block headers.
+	// document_id must not be less than the current ID
+	double GetBlockMaxTermFreq(int document_id, int& region_end) const;
+
+private:
+	const PostingList* postings_;
+	size_t block_index_ = 0;
+	size_t block_pos_ = 0;
+	size_t buffer_pos_ = 0;
+	int document_id_ = end_document_id;
+	bool in_buffer_ = false; // Whether the current posting comes from the append buffer
+	int document_ids_[block_size_]; // The decoded current block
+	uint32_t term_counts_[block_size_];
+
+	bool IsBlockEnd() const;
+	void LoadBlock(size_t block_index);
+	void Settle(); // Picks the current posting out of the block and the buffer after a move
+};
+
+// Called for every step of a query, so they are kept inline
+inline bool PostingList::Cursor::IsEnd() const
+{
+	return document_id_ == end_document_id;
+}
+
+inline int PostingList::Cursor::GetDocumentId() const
+{
+	return document_id_;
+}
+
+inline uint32_t PostingList::Cursor::GetTermCount() const
+{
+	return in_buffer_ ? postings_->buffer_term_counts_[buffer_pos_] : term_counts_[block_pos_];
+}
+
+template <typename Function>
+void PostingList::ForEach(Function function) const
+{
+	int document_ids[block_size_];
+	uint32_t term_counts[block_size_];
+	size_t buffer_pos = 0;
+	for (size_t block_index = 0; block_index < blocks_.size(); ++block_index)
+	{
+		DecodeBlock(block_index, document_ids, term_counts);
+		const size_t block_size = blocks_[block_index].size;
+		// Most blocks have no buffered posting inside their range and are passed on without merging
+		if (buffer_pos == buffer_document_ids_.size() || buffer_document_ids_[buffer_pos] > blocks_[block_index].last_document_id)
+		{
+			for (size_t i = 0; i < block_size; ++i)
+			{
+				function(document_ids[i], term_counts[i]);
+			}
+			continue;
+		}
+		for (size_t i = 0; i < block_size; ++i)
+		{
+			for (; buffer_pos < buffer_document_ids_.size() && buffer_document_ids_[buffer_pos] < document_ids[i]; ++buffer_pos)
+			{
+				function(buffer_document_ids_[buffer_pos], buffer_term_counts_[buffer_pos]);
+			}
+			function(document_ids[i], term_counts[i]);
+		}
+	}
+	for (; buffer_pos < buffer_document_ids_.size(); ++buffer_pos)
+	{
+		function(buffer_document_ids_[buffer_pos], buffer_term_counts_[buffer_pos]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include "search_server.h"
+#include "posting_list.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "log_duration.h"
+
+#define POSTINGS_SCAN_BENCHMARK(postings) ScanPostingsBenchmark(#postings, postings, posting_count, repeat_count)
+
+using namespace std;
+
+// Uncompressed layout the compressed posting lists are compared with: flat arrays of IDs and Term Frequencies
+struct FlatPostings
+{
+	std::vector<int> document_ids;
+	std::vector<double> term_freqs;
+
+	size_t GetMemoryUsage() const
+	{
+		return sizeof(FlatPostings) + document_ids.capacity() * sizeof(int) + term_freqs.capacity() * sizeof(double);
+	}
+};
+
+double SumTermFreqs(const FlatPostings& postings)
+{
+	double sum = 0;
+	for (size_t i = 0; i < postings.document_ids.size(); ++i)
+	{
+		sum += postings.term_freqs[i] * (postings.document_ids[i] & 1);
+	}
+	return sum;
+}
+
+double SumTermFreqs(const PostingList& postings)
+{
+	double sum = 0;
+	postings.ForEach([&sum](int document_id, uint32_t term_count)
+		{
+			sum += term_count * 0.01 * (document_id & 1);
+		});
+	return sum;
+}
+
+template <typename Postings>
+void ScanPostingsBenchmark(string_view mark, const Postings& postings, int posting_count, int repeat_count)
+{
+	double total = 0;
+	{
+		LOG_DURATION(mark);
+		for (int i = 0; i < repeat_count; ++i)
+		{
+			total += SumTermFreqs(postings);
+		}
+	}
+	cout << mark << ": "s << static_cast<double>(postings.GetMemoryUsage()) / posting_count << " bytes per posting, checksum "s << total << endl;
+}
+
+string GenerateWordPostingsBenchmark(mt19937& generator, int max_length)
+{
+	const int length = uniform_int_distribution(1, max_length)(generator);
+	string word;
+	word.reserve(length);
+	for (int i = 0; i < length; ++i)
+	{
+		word.push_back(uniform_int_distribution(static_cast<int>('a'), static_cast<int>('z'))(generator));
+	}
+	return word;
+}
+
+string GenerateDocumentPostingsBenchmark(mt19937& generator, const vector<string>& dictionary, int word_count)
+{
+	string document;
+	for (int i = 0; i < word_count; ++i)
+	{
+		if (!document.empty())
+		{
+			document.push_back(' ');
+		}
+		document += dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+	}
+	return document;
+}
+
+// Reports bytes per posting of the whole index and compares scanning of one long posting list in both layouts
+void CompressedPostingsBenchmark()
+{
+	mt19937 generator;
+	{
+		vector<string> dictionary;
+		for (int i = 0; i < 2'000; ++i)
+		{
+			dictionary.push_back(GenerateWordPostingsBenchmark(generator, 10));
+		}
+		SearchServer search_server("and with"s);
+		for (int id = 0; id < 20'000; ++id)
+		{
+			search_server.AddDocument(id, GenerateDocumentPostingsBenchmark(generator, dictionary, 50), DocumentStatus::ACTUAL, { 1, 2, 3 });
+		}
+		cout << "Index: "s << search_server.GetPostingCount() << " postings, "s
+			<< static_cast<double>(search_server.GetPostingsMemoryUsage()) / search_server.GetPostingCount() << " bytes per posting"s << endl;
+	}
+
+	const int posting_count = 1'000'000;
+	const int repeat_count = 100;
+	FlatPostings flat_postings;
+	PostingList compressed_postings;
+	int document_id = 0;
+	for (int i = 0; i < posting_count; ++i)
+	{
+		document_id += uniform_int_distribution(1, 20)(generator);
+		const uint32_t term_count = uniform_int_distribution(1, 4)(generator);
+		flat_postings.document_ids.push_back(document_id);
+		flat_postings.term_freqs.push_back(term_count * 0.01);
+		compressed_postings.Add(document_id, term_count, term_count * 0.01);
+	}
+	POSTINGS_SCAN_BENCHMARK(flat_postings);
+	POSTINGS_SCAN_BENCHMARK(compressed_postings);
+}
\ No newline at end of file
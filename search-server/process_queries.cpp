@@ -1,5 +1,6 @@
 #include "process_queries.h"
 #include <execution>
+#include <numeric>
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries)
 {
@@ -13,6 +14,18 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
 	return result;
 }
 
+std::vector<std::vector<Document>> ProcessQueriesCached(QueryResultCache& query_result_cache, const std::vector<std::string>& queries)
+{
+	std::vector<std::vector<Document>> result(queries.size());
+	std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(),
+		[&query_result_cache](const std::string& query)
+		{
+			return query_result_cache.FindTopDocuments(query);
+		}
+	);
+	return result;
+}
+
 //std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries)
 //{
 //	std::list<Document> documents;
@@ -23,21 +36,16 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
 //	return documents;
 //}
 
-std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries)
+JoinedResults ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries)
 {
-return std::transform_reduce(
-	std::execution::par,
-	queries.begin(), queries.end(),
-	std::list<Document>{},
-	[](std::list<Document> lhs, std::list<Document> rhs)
-	{
-		//const_cast<std::list<Document>&>(lhs).splice(const_cast<std::list<Document>&>(lhs).end(), const_cast<std::list<Document>&>(rhs));
-		lhs.splice(lhs.end(), rhs); // sacrificing constancy for speed
-		return lhs;
-	},
-	[&search_server](const std::string& query)
-	{
-		std::vector<Document> documents = search_server.FindTopDocuments(query);
-		return std::list<Document>{documents.begin(), documents.end()};
-	});
+	// Results are copied straight into their slices of one array instead of list nodes spliced together
+	JoinedResults results(queries.size(), MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<size_t> query_indexes(queries.size());
+	std::iota(query_indexes.begin(), query_indexes.end(), 0);
+	std::for_each(std::execution::par, query_indexes.begin(), query_indexes.end(), [&search_server, &queries, &results](size_t query_index)
+		{
+			results.Write(query_index, search_server.FindTopDocuments(queries[query_index]));
+		});
+	results.Join();
+	return results;
 }
\ No newline at end of file
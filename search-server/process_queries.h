@@ -1,7 +1,9 @@
 #pragma once
 
 #include "search_server.h"
-#include <list>
+#include "query_result_cache.h"
+#include "joined_results.h"
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
-std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
+std::vector<std::vector<Document>> ProcessQueriesCached(QueryResultCache& query_result_cache, const std::vector<std::string>& queries); // Repeated queries are taken from the cache
+JoinedResults ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries); // Documents of all queries in their order
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "query_executor.h"
+#include <chrono>
+
+QueryExecutor::QueryExecutor(size_t thread_count)
+{
+	thread_count = std::max<size_t>(thread_count, 1);
+	for (size_t i = 0; i < thread_count; ++i)
+	{
+		workers_.push_back(std::make_unique<Worker>());
+	}
+	// Started once every worker exists, as thieves look at all of them
+	for (size_t i = 0; i < thread_count; ++i)
+	{
+		workers_[i]->thread = std::thread([this, i] { RunWorker(i); });
+	}
+}
+
+QueryExecutor::~QueryExecutor()
+{
+	{
+		std::lock_guard lock(mutex_);
+		is_stopping_ = true;
+	}
+	batch_started_.notify_all();
+	for (const std::unique_ptr<Worker>& worker : workers_)
+	{
+		worker->thread.join();
+	}
+}
+
+size_t QueryExecutor::GetThreadCount() const
+{
+	return workers_.size();
+}
+
+std::vector<std::vector<Document>> QueryExecutor::ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries)
+{
+	std::vector<std::vector<Document>> result(queries.size());
+	Run(queries.size(), [&search_server, &queries, &result](size_t index)
+		{
+			result[index] = search_server.FindTopDocuments(queries[index]);
+		});
+	return result;
+}
+
+JoinedResults QueryExecutor::ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries)
+{
+	JoinedResults results(queries.size(), MAX_RESULT_DOCUMENT_COUNT);
+	Run(queries.size(), [&search_server, &queries, &results](size_t index)
+		{
+			results.Write(index, search_server.FindTopDocuments(queries[index]));
+		});
+	results.Join();
+	return results;
+}
+
+void QueryExecutor::Run(size_t task_count, const std::function<void(size_t)>& task)
+{
+	std::lock_guard batch_lock(batch_mutex_);
+	const auto start_time = std::chrono::steady_clock::now();
+
+	// Ranges are dealt evenly by count, stealing evens them out by cost
+	const size_t worker_count = workers_.size();
+	for (size_t i = 0; i < worker_count; ++i)
+	{
+		std::lock_guard lock(workers_[i]->mutex);
+		workers_[i]->begin = task_count * i / worker_count;
+		workers_[i]->end = task_count * (i + 1) / worker_count;
+	}
+	std::unique_lock lock(mutex_);
+	task_ = &task;
+	exception_ = nullptr;
+	is_cancelled_ = false;
+	stolen_task_count_ = 0;
+	running_worker_count_ = worker_count;
+	++batch_number_;
+	batch_started_.notify_all();
+	batch_finished_.wait(lock, [this]
+		{
+			return running_worker_count_ == 0;
+		});
+	task_ = nullptr;
+
+	last_batch_statistics_.task_count = task_count;
+	last_batch_statistics_.stolen_task_count = stolen_task_count_;
+	last_batch_statistics_.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+	if (exception_)
+	{
+		std::rethrow_exception(exception_);
+	}
+}
+
+QueryExecutor::BatchStatistics QueryExecutor::GetLastBatchStatistics() const
+{
+	std::lock_guard lock(mutex_);
+	return last_batch_statistics_;
+}
+
+double QueryExecutor::BatchStatistics::GetThroughput() const
+{
+	return seconds > 0.0 ? task_count / seconds : 0.0;
+}
+
+void QueryExecutor::RunWorker(size_t worker_index)
+{
+	uint64_t batch_number = 0;
+	while (true)
+	{
+		std::unique_lock lock(mutex_);
+		batch_started_.wait(lock, [this, batch_number]
+			{
+				return is_stopping_ || batch_number_ != batch_number;
+			});
+		if (is_stopping_)
+		{
+			return;
+		}
+		// A batch ends only when every worker has left it, so no worker can miss one
+		batch_number = batch_number_;
+		const std::function<void(size_t)>& task = *task_;
+		lock.unlock();
+
+		size_t index;
+		while (TakeTask(worker_index, index))
+		{
+			if (is_cancelled_)
+			{
+				continue;
+			}
+			try
+			{
+				task(index);
+			}
+			catch (...)
+			{
+				std::lock_guard exception_lock(mutex_);
+				if (!exception_)
+				{
+					exception_ = std::current_exception();
+				}
+				is_cancelled_ = true;
+			}
+		}
+
+		lock.lock();
+		if (--running_worker_count_ == 0)
+		{
+			batch_finished_.notify_all();
+		}
+	}
+}
+
+bool QueryExecutor::TakeTask(size_t worker_index, size_t& index)
+{
+	Worker& worker = *workers_[worker_index];
+	{
+		std::lock_guard lock(worker.mutex);
+		if (worker.begin < worker.end)
+		{
+			index = worker.begin++;
+			return true;
+		}
+	}
+	// Victims are tried from the next worker on, so thieves spread over the workers instead of all going to the first one
+	const size_t worker_count = workers_.size();
+	for (size_t offset = 1; offset < worker_count; ++offset)
+	{
+		Worker& victim = *workers_[(worker_index + offset) % worker_count];
+		size_t stolen_begin;
+		size_t stolen_end;
+		{
+			std::lock_guard lock(victim.mutex);
+			if (victim.begin == victim.end)
+			{
+				continue;
+			}
+			stolen_begin = victim.begin + (victim.end - victim.begin) / 2;
+			stolen_end = victim.end;
+			victim.end = stolen_begin;
+		}
+		stolen_task_count_ += stolen_end - stolen_begin;
+		std::lock_guard lock(worker.mutex);
+		index = stolen_begin;
+		worker.begin = stolen_begin + 1;
+		worker.end = stolen_end;
+		return true;
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include "search_server.h"
+#include "document.h"
+#include "joined_results.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs batches of queries on threads of its own. Every worker gets a contiguous range of the batch and takes tasks from its front,
+// a worker that runs out steals the back half of the range of another one, so whoever drew the heavy queries gets help
+// instead of setting the time of the batch. The workers live as long as the executor, so the per-thread scratch of the search
+// (score accumulators, split buffers, query terms, exclusion bitmaps, top collectors) is allocated once and stays warm across batches.
+// A warm worker then allocates only the result vector of a query
+class QueryExecutor
+{
+public:
+	explicit QueryExecutor(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+	~QueryExecutor(); // Waits for the workers to finish, no batch may be running
+	QueryExecutor(const QueryExecutor&) = delete;
+	QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+	size_t GetThreadCount() const;
+
+	// The same results as the free functions of process_queries.h, in the order of the queries.
+	// If a query throws, the rest of the batch is skipped and the first exception is rethrown here
+	std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
+	JoinedResults ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+	// Calls task(index) for every index below task_count on the workers and returns once all calls are over. Batches run one at a time
+	void Run(size_t task_count, const std::function<void(size_t)>& task);
+
+	struct BatchStatistics
+	{
+		size_t task_count = 0;
+		size_t stolen_task_count = 0; // Tasks moved to another worker by stealing, a task stolen twice counts twice
+		double seconds = 0.0;
+
+		double GetThroughput() const; // Tasks per second
+	};
+	BatchStatistics GetLastBatchStatistics() const;
+
+private:
+	struct Worker
+	{
+		std::mutex mutex; // Guards the range, which the owner and thieves change
+		size_t begin = 0; // Indexes of the current batch left to this worker
+		size_t end = 0;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::mutex batch_mutex_; // One batch at a time
+	mutable std::mutex mutex_; // Guards the state of the batch below
+	std::condition_variable batch_started_;
+	std::condition_variable batch_finished_;
+	const std::function<void(size_t)>* task_ = nullptr;
+	uint64_t batch_number_ = 0; // Workers start a batch when it changes
+	size_t running_worker_count_ = 0;
+	bool is_stopping_ = false;
+	std::exception_ptr exception_; // The first one thrown by a task of the batch
+	std::atomic<bool> is_cancelled_ = false; // Set by a failed task, the others are skipped
+	std::atomic<size_t> stolen_task_count_ = 0;
+	BatchStatistics last_batch_statistics_;
+
+	void RunWorker(size_t worker_index);
+	bool TakeTask(size_t worker_index, size_t& index); // From the own range first, then steals. False once no range has tasks
+};
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "query_result_cache.h"
+
+QueryResultCache::QueryResultCache(const SearchServer& search_server, size_t capacity)
+	: search_server_(search_server),
+	capacity_(capacity)
+{}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count)
+{
+	return FindTopDocuments(std::execution::seq, raw_query, filter, max_result_count);
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count)
+{
+	return FindTopDocuments(std::execution::seq, raw_query, status, max_result_count);
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query)
+{
+	return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+size_t QueryResultCache::GetHitCount() const
+{
+	return hit_count_;
+}
+
+size_t QueryResultCache::GetMissCount() const
+{
+	return miss_count_;
+}
+
+size_t QueryResultCache::GetSize() const
+{
+	std::lock_guard<std::mutex> guard(mutex_);
+	return entries_.size();
+}
+
+void QueryResultCache::Clear()
+{
+	std::lock_guard<std::mutex> guard(mutex_);
+	key_to_entry_.clear();
+	entries_.clear();
+}
+
+std::string QueryResultCache::MakeKey(const std::string& normalized_query, const DocumentFilter& filter, size_t max_result_count)
+{
+	// The normalized query has no line breaks, so it cannot run into the rest
+	std::string key = normalized_query;
+	key.push_back('\n');
+	key += std::to_string(filter.statuses.to_ulong()) + ' ' + std::to_string(filter.min_rating) + ' ' + std::to_string(filter.max_rating) + ' ' + std::to_string(max_result_count);
+	return key;
+}
+
+bool QueryResultCache::FindEntry(const std::string& key, uint64_t index_epoch, std::vector<Document>& documents)
+{
+	std::lock_guard<std::mutex> guard(mutex_);
+	const auto it = key_to_entry_.find(key);
+	if (it == key_to_entry_.end())
+	{
+		++miss_count_;
+		return false;
+	}
+	const auto entry = it->second;
+	if (entry->index_epoch != index_epoch)
+	{
+		key_to_entry_.erase(it); // Found before the index changed, it will never be valid again
+		entries_.erase(entry);
+		++miss_count_;
+		return false;
+	}
+	entries_.splice(entries_.begin(), entries_, entry);
+	documents = entry->documents;
+	++hit_count_;
+	return true;
+}
+
+void QueryResultCache::AddEntry(std::string key, uint64_t index_epoch, const std::vector<Document>& documents)
+{
+	if (capacity_ == 0)
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> guard(mutex_);
+	const auto it = key_to_entry_.find(key);
+	if (it != key_to_entry_.end())
+	{
+		// Another thread has found the same query meanwhile. A slower search of an older index must not replace its results
+		if (index_epoch >= it->second->index_epoch)
+		{
+			it->second->index_epoch = index_epoch;
+			it->second->documents = documents;
+		}
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return;
+	}
+	entries_.push_front({ std::move(key), index_epoch, documents });
+	key_to_entry_.emplace(entries_.front().key, entries_.begin());
+	if (entries_.size() > capacity_)
+	{
+		key_to_entry_.erase(entries_.back().key);
+		entries_.pop_back();
+	}
+}
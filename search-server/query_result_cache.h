@@ -0,0 +1,105 @@
+#pragma once
+#include "search_server.h"
+#include "document.h"
+#include "document_filter.h"
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Keeps the results of recent searches of a server, the least recently used ones are dropped once the capacity is reached.
+// Queries with the same words in any order and with any repeats share an entry, results found before the index changed are never returned.
+// A hit only normalizes the text of the query, its words are looked up in the index and given IDFs on a miss.
+// Searches may run concurrently, the server must not change during them
+class QueryResultCache
+{
+public:
+	QueryResultCache(const SearchServer& search_server, size_t capacity);
+
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT);
+
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query);
+	std::vector<Document> FindTopDocuments(std::string_view raw_query);
+
+	size_t GetHitCount() const;
+	size_t GetMissCount() const; // Stale entries are counted as misses
+	size_t GetSize() const;
+	void Clear(); // Drops the entries, the counters are kept
+
+private:
+	struct Entry
+	{
+		std::string key;
+		uint64_t index_epoch = 0; // Epoch of the server when the documents were found
+		std::vector<Document> documents;
+	};
+
+	const SearchServer& search_server_;
+	const size_t capacity_;
+	mutable std::mutex mutex_; // Guards the entries, even a hit moves its entry to the front
+	std::list<Entry> entries_; // The most recently used first
+	std::unordered_map<std::string_view, std::list<Entry>::iterator> key_to_entry_; // Keys point into the entries
+	std::atomic<size_t> hit_count_ = 0;
+	std::atomic<size_t> miss_count_ = 0;
+
+	// The normalized query, then the filter and the result count. A status is keyed as the filter of that status and the policy
+	// is not keyed, the results are the same whichever way they are found
+	static std::string MakeKey(const std::string& normalized_query, const DocumentFilter& filter, size_t max_result_count);
+	bool FindEntry(const std::string& key, uint64_t index_epoch, std::vector<Document>& documents);
+	void AddEntry(std::string key, uint64_t index_epoch, const std::vector<Document>& documents);
+
+	// Runs search(prepared query) on a miss, the lock is not held meanwhile so other queries are not blocked by it
+	template <typename Search>
+	std::vector<Document> FindCached(std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count, Search search);
+};
+
+template <typename ExecutionPolicy>
+std::vector<Document> QueryResultCache::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count)
+{
+	return FindCached(raw_query, filter, max_result_count, [this, &policy, &filter, max_result_count](const SearchServer::PreparedQuery& query)
+		{
+			return search_server_.FindTopDocuments(policy, query, filter, max_result_count);
+		});
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> QueryResultCache::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status, size_t max_result_count)
+{
+	DocumentFilter filter;
+	filter.statuses = StatusSet().set(static_cast<size_t>(status));
+	return FindCached(raw_query, filter, max_result_count, [this, &policy, status, max_result_count](const SearchServer::PreparedQuery& query)
+		{
+			return search_server_.FindTopDocuments(policy, query, status, max_result_count); // The status partitions are cheaper than a filter
+		});
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> QueryResultCache::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query)
+{
+	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename Search>
+std::vector<Document> QueryResultCache::FindCached(std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count, Search search)
+{
+	std::string key = MakeKey(search_server_.NormalizeQuery(raw_query), filter, max_result_count);
+	const uint64_t index_epoch = search_server_.GetIndexEpoch();
+	std::vector<Document> documents;
+	if (FindEntry(key, index_epoch, documents))
+	{
+		return documents;
+	}
+	documents = search(search_server_.PrepareQuery(raw_query));
+	AddEntry(std::move(key), index_epoch, documents);
+	return documents;
+}
@@ -1,21 +1,24 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
+RequestQueue::RequestQueue(const SearchServer& search_server, RequestStatistics* statistics)
 	: search_server_(search_server),
+	statistics_(statistics),
 	no_result_requests_(0)
 {}
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status)
 {
+	const auto start_time = RequestStatistics::Clock::now();
 	const auto search_results = search_server_.FindTopDocuments(raw_query, status);
-	AddRequest(search_results);
+	AddRequest(start_time, search_results);
 	return search_results;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 {
+	const auto start_time = RequestStatistics::Clock::now();
 	const auto search_results = search_server_.FindTopDocuments(raw_query);
-	AddRequest(search_results);
+	AddRequest(start_time, search_results);
 	return search_results;
 }
 
@@ -24,8 +27,13 @@ int RequestQueue::GetNoResultRequests() const
 	return no_result_requests_;
 }
 
-void RequestQueue::AddRequest(const std::vector<Document>& search_results)
+void RequestQueue::AddRequest(RequestStatistics::Clock::time_point start_time, const std::vector<Document>& search_results)
 {
+	if (statistics_)
+	{
+		const auto now = RequestStatistics::Clock::now();
+		statistics_->Record(now - start_time, search_results.size(), now);
+	}
 	QueryResult new_result;
 	if (search_results.empty())
 	{
@@ -1,19 +1,22 @@
 #pragma once
 #include "search_server.h"
 #include "document.h"
+#include "request_statistics.h"
 #include <deque>
 
 class RequestQueue
 {
 public:
-	explicit RequestQueue(const SearchServer& search_server);
+	// Requests are also recorded to statistics if it is given, with the time taken by the search
+	explicit RequestQueue(const SearchServer& search_server, RequestStatistics* statistics = nullptr);
 
 	// make "wrappers" for all search methods to store results for our statistics
 	template <typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate)
 	{
+		const auto start_time = RequestStatistics::Clock::now();
 		const auto search_results = search_server_.FindTopDocuments(raw_query, document_predicate);
-		AddRequest(search_results);
+		AddRequest(start_time, search_results);
 		return search_results;
 	}
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
@@ -23,6 +26,7 @@ public:
 	int GetNoResultRequests() const;
 private:
 	const SearchServer& search_server_;
+	RequestStatistics* statistics_;
 	struct QueryResult
 	{
 		bool no_result = false;
@@ -31,5 +35,5 @@ private:
 	int no_result_requests_;
 	const static int min_in_day_ = 1440;
 
-	void AddRequest(const std::vector<Document>& search_results);
+	void AddRequest(RequestStatistics::Clock::time_point start_time, const std::vector<Document>& search_results);
 };
\ No newline at end of file
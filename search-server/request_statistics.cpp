@@ -0,0 +1,147 @@
+#include "request_statistics.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+double RequestStatistics::Summary::GetNoResultRate() const
+{
+	return request_count > 0 ? static_cast<double>(no_result_request_count) / request_count : 0.0;
+}
+
+RequestStatistics::RequestStatistics(size_t shard_count)
+	: start_time_(Clock::now())
+{
+	shard_count = std::max<size_t>(shard_count, 1);
+	for (size_t i = 0; i < shard_count; ++i)
+	{
+		shards_.push_back(std::make_unique<Shard>());
+	}
+}
+
+void RequestStatistics::Record(Clock::duration latency, size_t result_count, Clock::time_point time)
+{
+	// Threads are numbered on their first request, so up to shard_count of them never share a shard
+	static std::atomic<size_t> thread_count = 0;
+	thread_local const size_t thread_index = thread_count++;
+
+	const int64_t second = GetSecond(time);
+	const size_t latency_bin = GetLatencyBin(latency);
+	const size_t result_count_bin = std::min(result_count, result_count_bin_count_ - 1);
+	Shard& shard = *shards_[thread_index % shards_.size()];
+	std::lock_guard lock(shard.mutex);
+	AddToBucket(shard.seconds[second % second_bucket_count_], second, latency_bin, result_count_bin);
+	AddToBucket(shard.minutes[second / 60 % minute_bucket_count_], second / 60, latency_bin, result_count_bin);
+	AddToBucket(shard.hours[second / 3600 % hour_bucket_count_], second / 3600, latency_bin, result_count_bin);
+}
+
+RequestStatistics::Summary RequestStatistics::GetSummary(Window window, Clock::time_point now) const
+{
+	// Every window is a whole ring, so only the buckets of older periods are skipped
+	const int64_t second = GetSecond(now);
+	const int64_t period_length = window == Window::MINUTE ? 1 : window == Window::HOUR ? 60 : 3600;
+	const int64_t last_period = second / period_length;
+	const int64_t period_count = window == Window::DAY ? hour_bucket_count_ : 60;
+
+	std::array<uint64_t, latency_bin_count_> latency_counts = {};
+	Summary summary;
+	summary.result_count_distribution.assign(result_count_bin_count_, 0);
+	for (const std::unique_ptr<Shard>& shard : shards_)
+	{
+		std::lock_guard lock(shard->mutex);
+		for (const Bucket& bucket : window == Window::MINUTE ? shard->seconds : window == Window::HOUR ? shard->minutes : shard->hours)
+		{
+			if (bucket.period < 0 || bucket.period > last_period || bucket.period <= last_period - period_count)
+			{
+				continue;
+			}
+			for (size_t i = 0; i < latency_bin_count_; ++i)
+			{
+				latency_counts[i] += bucket.latency_counts[i];
+			}
+			for (size_t i = 0; i < result_count_bin_count_; ++i)
+			{
+				summary.result_count_distribution[i] += bucket.result_counts[i];
+			}
+		}
+	}
+	for (const uint64_t count : summary.result_count_distribution)
+	{
+		summary.request_count += count;
+	}
+	summary.no_result_request_count = summary.result_count_distribution[0];
+
+	// The bin of the request of the nearest rank, the first one where the requests counted so far reach the share
+	const auto get_percentile = [&latency_counts, &summary](double share)
+	{
+		const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(share * summary.request_count)), 1);
+		uint64_t count = 0;
+		for (size_t i = 0; i < latency_bin_count_; ++i)
+		{
+			count += latency_counts[i];
+			if (count >= rank)
+			{
+				return GetLatencyBinEnd(i);
+			}
+		}
+		return Clock::duration{};
+	};
+	summary.latency_p50 = get_percentile(0.5);
+	summary.latency_p99 = get_percentile(0.99);
+	summary.latency_p999 = get_percentile(0.999);
+	return summary;
+}
+
+int64_t RequestStatistics::GetSecond(Clock::time_point time) const
+{
+	return std::max<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(time - start_time_).count(), 0);
+}
+
+size_t RequestStatistics::GetLatencyBin(Clock::duration latency)
+{
+	const uint64_t nanoseconds = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count(), 0);
+	if (nanoseconds >> min_latency_octave_ == 0)
+	{
+		return 0;
+	}
+	int octave = min_latency_octave_;
+	while (octave < max_latency_octave_ && nanoseconds >> (octave + 1) != 0)
+	{
+		++octave;
+	}
+	if (nanoseconds >> (octave + 1) != 0)
+	{
+		return latency_bin_count_ - 1;
+	}
+	// The two bits below the highest one pick the quarter of the octave
+	return 1 + (octave - min_latency_octave_) * 4 + ((nanoseconds >> (octave - 2)) & 3);
+}
+
+RequestStatistics::Clock::duration RequestStatistics::GetLatencyBinEnd(size_t bin)
+{
+	if (bin == 0)
+	{
+		return std::chrono::nanoseconds(1ll << min_latency_octave_);
+	}
+	if (bin == latency_bin_count_ - 1)
+	{
+		return Clock::duration::max();
+	}
+	const int octave = min_latency_octave_ + static_cast<int>(bin - 1) / 4;
+	const int64_t quarter = static_cast<int64_t>(bin - 1) % 4;
+	return std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds((5 + quarter) << (octave - 2)));
+}
+
+void RequestStatistics::AddToBucket(Bucket& bucket, int64_t period, size_t latency_bin, size_t result_count_bin)
+{
+	if (bucket.period != period)
+	{
+		if (bucket.period > period)
+		{
+			return; // A request late by more than the ring, its bucket already counts a newer period
+		}
+		bucket = Bucket();
+		bucket.period = period;
+	}
+	++bucket.latency_counts[latency_bin];
+	++bucket.result_counts[result_count_bin];
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include "search_server.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Statistics of requests over the last minute, hour and day of real time, recorded by any number of threads at once.
+// Every thread records into a shard of its own while there are enough shards, so the mutex of a shard is practically never contended.
+// A shard keeps rings of per-second buckets for the last minute, per-minute ones for the last hour and per-hour ones for the last day,
+// a bucket is reset when the ring comes around to it again. A shard takes about 70 KB. Latencies go to a histogram with 4 bins per power of two,
+// so percentiles are upper bounds at most 25% above the true value
+class RequestStatistics
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Window
+	{
+		MINUTE,
+		HOUR,
+		DAY,
+	};
+
+	struct Summary
+	{
+		uint64_t request_count = 0;
+		uint64_t no_result_request_count = 0;
+		std::vector<uint64_t> result_count_distribution; // Requests by the number of documents found, the last element counts all above MAX_RESULT_DOCUMENT_COUNT
+		Clock::duration latency_p50 = {};
+		Clock::duration latency_p99 = {};
+		Clock::duration latency_p999 = {}; // Clock::duration::max() if the percentile is 2^37 ns or more
+
+		double GetNoResultRate() const;
+	};
+
+	explicit RequestStatistics(size_t shard_count = std::max(1u, std::thread::hardware_concurrency()));
+
+	void Record(Clock::duration latency, size_t result_count, Clock::time_point time = Clock::now());
+	// The current second, minute or hour counts as a whole one, so the hour window may begin up to a minute earlier and the day one up to an hour
+	Summary GetSummary(Window window, Clock::time_point now = Clock::now()) const;
+
+private:
+	static constexpr size_t second_bucket_count_ = 60;
+	static constexpr size_t minute_bucket_count_ = 60;
+	static constexpr size_t hour_bucket_count_ = 24;
+	static constexpr int min_latency_octave_ = 10; // Latencies below 2^10 ns share the first bin
+	static constexpr int max_latency_octave_ = 36;
+	// The first bin, 4 per octave up to max_latency_octave_, and one for latencies from 2^37 ns (about 2 minutes) on
+	static constexpr size_t latency_bin_count_ = 2 + (max_latency_octave_ - min_latency_octave_ + 1) * 4;
+	static constexpr size_t result_count_bin_count_ = MAX_RESULT_DOCUMENT_COUNT + 2;
+
+	struct Bucket
+	{
+		int64_t period = -1; // The second, minute or hour counted, -1 if none was yet
+		std::array<uint32_t, latency_bin_count_> latency_counts = {};
+		std::array<uint32_t, result_count_bin_count_> result_counts = {};
+	};
+
+	struct Shard
+	{
+		std::mutex mutex;
+		std::vector<Bucket> seconds = std::vector<Bucket>(second_bucket_count_);
+		std::vector<Bucket> minutes = std::vector<Bucket>(minute_bucket_count_);
+		std::vector<Bucket> hours = std::vector<Bucket>(hour_bucket_count_);
+	};
+
+	const Clock::time_point start_time_; // Periods are counted from it
+	std::vector<std::unique_ptr<Shard>> shards_;
+
+	int64_t GetSecond(Clock::time_point time) const;
+	static size_t GetLatencyBin(Clock::duration latency);
+	static Clock::duration GetLatencyBinEnd(size_t bin); // Clock::duration::max() for the overflow bin
+	static void AddToBucket(Bucket& bucket, int64_t period, size_t latency_bin, size_t result_count_bin);
+};
\ No newline at end of file
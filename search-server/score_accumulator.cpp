@@ -0,0 +1,41 @@
+#include "score_accumulator.h"
+#include <algorithm>
+
+namespace
+{
+	const uint32_t unused_epoch = 0; // Never used by a query, marks entries no query has written
+}
+
+ScoreAccumulator& ScoreAccumulator::ForCurrentThread()
+{
+	thread_local ScoreAccumulator accumulator;
+	return accumulator;
+}
+
+void ScoreAccumulator::Reset(size_t slot_count)
+{
+	if (relevances_.size() < slot_count)
+	{
+		relevances_.resize(slot_count);
+		epochs_.resize(slot_count, unused_epoch);
+	}
+	touched_slots_.clear();
+	++epoch_;
+	if (epoch_ == unused_epoch)
+	{
+		// After 2^32 queries the tags wrap around, so the old ones are wiped once
+		std::fill(epochs_.begin(), epochs_.end(), unused_epoch);
+		++epoch_;
+	}
+}
+
+void ScoreAccumulator::Add(uint32_t slot, double relevance)
+{
+	if (epochs_[slot] != epoch_)
+	{
+		epochs_[slot] = epoch_;
+		relevances_[slot] = 0.0;
+		touched_slots_.push_back(slot);
+	}
+	relevances_[slot] += relevance;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scratchpad for summing relevance of one query: a dense array indexed by document slot.
+// Each entry is tagged with the epoch of the query that wrote it, and touched slots are listed,
+// so starting a new query and reading the results cost as much as the query matched, not the corpus size
+class ScoreAccumulator
+{
+public:
+	static ScoreAccumulator& ForCurrentThread(); // Reused by all queries of the thread, a query must not start another one while scoring
+
+	void Reset(size_t slot_count); // Forgets the previous query, slots below slot_count may be used
+	void Add(uint32_t slot, double relevance);
+
+	template <typename Function>
+	void ForEach(Function function) const; // Calls function(slot, relevance) for the slots added since Reset
+
+private:
+	std::vector<double> relevances_;
+	std::vector<uint32_t> epochs_; // relevances_[slot] belongs to the current query only if epochs_[slot] == epoch_
+	std::vector<uint32_t> touched_slots_;
+	uint32_t epoch_ = 0;
+};
+
+template <typename Function>
+void ScoreAccumulator::ForEach(Function function) const
+{
+	for (const uint32_t slot : touched_slots_)
+	{
+		function(slot, relevances_[slot]);
+	}
+}
\ No newline at end of file
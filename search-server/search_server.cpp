@@ -1,6 +1,7 @@
 #include "search_server.h"
 #include <numeric>
 #include <cmath>
+#include <unordered_set>
 
 using namespace std;
 
@@ -14,57 +15,126 @@ std::set<int>::iterator SearchServer::end()
 	return documents_ids_.end();
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const
 {
-	static std::map<std::string_view, double> empty_map;
-	return document_to_word_freqs_.count(document_id) == 0 ? empty_map : document_to_word_freqs_.at(document_id);
+	std::map<std::string_view, double> word_freqs;
+	if (document_id_to_slot_.count(document_id) == 0)
+	{
+		return word_freqs;
+	}
+	for (const auto [term_id, term_freq] : document_to_word_freqs_[document_id_to_slot_.at(document_id)])
+	{
+		word_freqs.emplace(terms_.GetWord(term_id), term_freq);
+	}
+	return word_freqs;
 }
 
 void SearchServer::RemoveDocument(int document_id)
 {
-	if (!document_to_word_freqs_.count(document_id))
+	if (!document_id_to_slot_.count(document_id))
 	{
 		throw std::invalid_argument("Invalid ID for deleting");
 	}
-	std::map<std::string_view, double>& word_n_freqs = document_to_word_freqs_.at(document_id);
+	const uint32_t slot = document_id_to_slot_.at(document_id);
 
-	for (auto& [word, id_and_freq] : word_n_freqs)
+	for (const auto [term_id, term_freq] : document_to_word_freqs_[slot])
 	{
-		word_to_document_freqs_.at(word).erase(document_id);
+		GetPostings(term_id, slot).Erase(slot);
+		ReleaseUnusedTerm(term_id);
 	}
 
-	document_to_word_freqs_.erase(document_id);
-	documents_.erase(document_id);
-	documents_ids_.erase(document_id);
+	DetachSlot(slot);
+	ReleaseSlot(slot);
+	++index_epoch_;
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids)
+{
+	std::vector<uint32_t> slots;
+	slots.reserve(document_ids.size());
+	for (const int document_id : document_ids)
+	{
+		const auto it = document_id_to_slot_.find(document_id);
+		if (it == document_id_to_slot_.end())
+		{
+			throw std::invalid_argument("Invalid ID for deleting");
+		}
+		slots.push_back(it->second);
+	}
+	std::sort(slots.begin(), slots.end());
+	if (std::adjacent_find(slots.begin(), slots.end()) != slots.end())
+	{
+		throw std::invalid_argument("Invalid ID for deleting");
+	}
+
+	// Only the counts behind IDFs follow the removal, so the scores are those of the index without the documents
+	removed_slots_.resize(slot_document_ids_.size());
+	term_removed_document_counts_.resize(terms_.GetTermCount());
+	for (const uint32_t slot : slots)
+	{
+		for (const auto [term_id, term_freq] : document_to_word_freqs_[slot])
+		{
+			++term_removed_document_counts_[term_id];
+		}
+		removed_slots_[slot] = true;
+		DetachSlot(slot);
+	}
+	removed_slot_count_ += slots.size();
+	index_epoch_ += slots.size();
+}
+
+void SearchServer::PurgeRemovedDocuments()
+{
+	PurgeRemovedDocuments(std::execution::seq);
+}
+
+size_t SearchServer::GetRemovedDocumentCount() const
+{
+	return removed_slot_count_;
 }
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
 {
-	if (document_id < 0 || static_cast<bool>(documents_.count(document_id)))
+	if (document_id < 0 || static_cast<bool>(document_id_to_slot_.count(document_id)))
 	{
 		throw invalid_argument("Wrong document ID"s);
 	}
 
-	auto words = SplitIntoWordsNoStop(document);
-	const double inv_word_count = 1.0 / words.size(); // First stage of calculating TF
-	const std::string document_string{ document };
-	documents_.emplace(document_id, SearchServer::DocumentData{ ComputeAverageRating(ratings), status, document_string });
-	words = SplitIntoWordsNoStop(documents_.at(document_id).document_text_);
-	for (const std::string_view word : words)
+	thread_local WordCounts word_counts; // Reused by the next documents of the thread, so the words are not allocated again
+	size_t word_count;
+	if (!CountWords(document, word_counts, word_count))
 	{
-		word_to_document_freqs_[word][document_id] += inv_word_count; // Final calculating TF of each word
-		document_to_word_freqs_[document_id][word] += word_to_document_freqs_[word][document_id];
+		throw invalid_argument("Invalid symbols in document"s);
 	}
-	
-	documents_ids_.insert(document_id);
+	thread_local TermCounts term_counts;
+	InternWords(word_counts, term_counts);
+	std::sort(term_counts.begin(), term_counts.end());
+
+	const double inv_word_count = 1.0 / word_count; // First stage of calculating TF
+	const uint32_t slot = AllocateSlot(document_id, status, ComputeAverageRating(ratings), inv_word_count);
+	std::map<TermId, double>& term_freqs = document_to_word_freqs_[slot];
+	word_to_document_freqs_.resize(terms_.GetTermCount());
+	for (const auto& [term_id, term_count] : term_counts)
+	{
+		term_freqs.emplace_hint(term_freqs.end(), term_id, term_count * inv_word_count); // Final calculating TF of each word, IDs come in order
+		GetPostings(term_id, slot).Add(slot, term_count, term_count * inv_word_count); // Each posting list gets the document once
+	}
+	++index_epoch_;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const
+void SearchServer::AddDocuments(const std::vector<DocumentRecord>& documents)
 {
-	return FindTopDocuments(std::execution::seq, raw_query, [&status](int document_id, DocumentStatus document_status, int rating)
-		{
-			return document_status == status;
-		});
+	AddDocuments(std::execution::seq, documents);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count) const
+{
+	return FindTopDocuments(std::execution::seq, raw_query, status, max_result_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count) const
+{
+	return FindTopDocuments(std::execution::seq, raw_query, filter, max_result_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const
@@ -72,89 +142,277 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
 	return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, const DocumentFilter& filter, size_t max_result_count) const
+{
+	return FindTopDocuments(std::execution::seq, query, filter, max_result_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status, size_t max_result_count) const
+{
+	return FindTopDocuments(std::execution::seq, query, status, max_result_count);
+}
+
+std::vector<bool> SearchServer::MarkDocumentSlots(const std::set<int>& document_ids) const
+{
+	std::vector<bool> marks(slot_document_ids_.size());
+	for (const int document_id : document_ids)
+	{
+		if (HasDocument(document_id))
+		{
+			marks[GetSlot(document_id)] = true;
+		}
+	}
+	return marks;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, const std::vector<bool>& removed_slots, DocumentStatus status, size_t max_result_count) const
+{
+	return FindTopQueryDocuments(std::execution::seq, GetMarkedQuery(query, removed_slots), status, max_result_count);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const
+{
+	return FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL);
+}
+
 int SearchServer::GetDocumentCount() const
 {
-	return documents_.size();
+	return static_cast<int>(documents_ids_.size());
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+size_t SearchServer::GetPostingCount() const
 {
-	//LOG_DURATION_STREAM("Operation time: ", std::cout);
-	if (document_id < 0)
+	size_t posting_count = 0;
+	for (const StatusPostings& status_postings : word_to_document_freqs_)
 	{
-		throw std::out_of_range("Document ID is negative"s);
+		for (const PostingList& postings : status_postings)
+		{
+			posting_count += postings.Size();
+		}
 	}
-	if (documents_.count(document_id) == 0)
+	return posting_count;
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const
+{
+	size_t memory_usage = 0;
+	for (const StatusPostings& status_postings : word_to_document_freqs_)
 	{
-		throw std::invalid_argument("Document ID is missing"s);
+		for (const PostingList& postings : status_postings)
+		{
+			memory_usage += postings.GetMemoryUsage();
+		}
 	}
-	const SearchServer::Query query = ParseQuery(raw_query, false); //bool with_execution_policy
-	std::vector<std::string_view> matched_words;
-	for (const std::string_view word : query.minus_words)
+	return memory_usage;
+}
+
+bool SearchServer::HasDocument(int document_id) const
+{
+	return document_id_to_slot_.count(document_id) > 0;
+}
+
+SearchServer::QueryStatistics SearchServer::GetQueryStatistics(const PreparedQuery& query) const
+{
+	QueryStatistics statistics;
+	statistics.document_count = GetDocumentCount();
+	for (const std::string& word : query.GetPlusWords())
+	{
+		const auto term_id = terms_.Find(word);
+		statistics.plus_word_document_counts.push_back(term_id ? static_cast<int>(GetDocumentFreq(*term_id)) : 0);
+	}
+	return statistics;
+}
+
+void SearchServer::MergeDocuments(const SearchServer& other, const std::set<int>& removed_document_ids)
+{
+	if (other.stop_words_ != stop_words_)
 	{
-		if (word_to_document_freqs_.count(word) == 0)
+		throw std::invalid_argument("Servers have different stop words"s);
+	}
+	for (const int document_id : other.documents_ids_)
+	{
+		if (HasDocument(document_id) && !removed_document_ids.count(document_id))
 		{
-			continue;
+			throw std::invalid_argument("Wrong document ID"s);
 		}
-		if (word_to_document_freqs_.at(word).count(document_id))
+	}
+
+	// Slots of the other server are mapped to new ones in their order, so an empty server gets its posting lists by appends only.
+	// Term IDs of the other server are mapped to IDs of this dictionary
+	const uint32_t no_slot = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> slots(other.slot_document_ids_.size(), no_slot);
+	for (uint32_t other_slot = 0; other_slot < slots.size(); ++other_slot)
+	{
+		const int document_id = other.slot_document_ids_[other_slot];
+		const auto it = other.document_id_to_slot_.find(document_id);
+		if (it != other.document_id_to_slot_.end() && it->second == other_slot && !removed_document_ids.count(document_id)) // Free and removed slots are skipped
 		{
-			return { {}, documents_.at(document_id).status };
+			slots[other_slot] = AllocateSlot(document_id, other.slot_statuses_[other_slot], other.slot_ratings_[other_slot], other.slot_inv_word_counts_[other_slot]);
 		}
 	}
-	for (const std::string_view word : query.plus_words)
+	// Words only the removed documents had are not brought over
+	const TermId no_term = std::numeric_limits<TermId>::max();
+	std::vector<TermId> term_ids(other.terms_.GetTermCount(), no_term);
+	for (uint32_t other_slot = 0; other_slot < slots.size(); ++other_slot)
 	{
-		if (word_to_document_freqs_.count(word) == 0)
+		if (slots[other_slot] != no_slot)
+		{
+			std::map<TermId, double>& term_freqs = document_to_word_freqs_[slots[other_slot]];
+			for (const auto& [other_term_id, term_freq] : other.document_to_word_freqs_[other_slot])
+			{
+				if (term_ids[other_term_id] == no_term)
+				{
+					term_ids[other_term_id] = terms_.Intern(other.terms_.GetWord(other_term_id));
+				}
+				term_freqs.emplace(term_ids[other_term_id], term_freq);
+			}
+		}
+	}
+	word_to_document_freqs_.resize(terms_.GetTermCount());
+
+	// Postings are read term by term, every list of the other server is decoded once
+	for (TermId other_term_id = 0; other_term_id < term_ids.size(); ++other_term_id)
+	{
+		if (term_ids[other_term_id] == no_term)
 		{
 			continue;
 		}
-		if (word_to_document_freqs_.at(word).count(document_id))
+		for (const PostingList& postings : other.word_to_document_freqs_[other_term_id])
 		{
-			matched_words.emplace_back(word);
+			postings.ForEach([this, &slots, term_id = term_ids[other_term_id], no_slot](int other_slot, uint32_t term_count)
+				{
+					const uint32_t slot = slots[other_slot];
+					if (slot != no_slot)
+					{
+						GetPostings(term_id, slot).Add(slot, term_count, term_count * slot_inv_word_counts_[slot]);
+					}
+				});
 		}
 	}
-	return { matched_words, documents_.at(document_id).status };
+	++index_epoch_;
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy policy, std::string_view raw_query, int document_id) const
+void SearchServer::ShrinkToFit()
 {
-	return MatchDocument(raw_query, document_id);
+	for (StatusPostings& status_postings : word_to_document_freqs_)
+	{
+		for (PostingList& postings : status_postings)
+		{
+			postings.ShrinkToFit();
+		}
+	}
+	word_to_document_freqs_.shrink_to_fit();
+	slot_document_ids_.shrink_to_fit();
+	slot_statuses_.shrink_to_fit();
+	slot_ratings_.shrink_to_fit();
+	slot_inv_word_counts_.shrink_to_fit();
+	document_to_word_freqs_.shrink_to_fit();
+	free_slots_.shrink_to_fit();
 }
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const
+
+void SearchServer::Compact()
 {
+	// The documents are copied into a new index, which takes only live slots and terms, and it replaces every table but the stop words
+	SearchServer compacted(stop_words_);
+	compacted.MergeDocuments(*this);
+	compacted.ShrinkToFit();
+	terms_ = std::move(compacted.terms_);
+	word_to_document_freqs_ = std::move(compacted.word_to_document_freqs_);
+	document_id_to_slot_ = std::move(compacted.document_id_to_slot_);
+	slot_document_ids_ = std::move(compacted.slot_document_ids_);
+	slot_statuses_ = std::move(compacted.slot_statuses_);
+	slot_ratings_ = std::move(compacted.slot_ratings_);
+	slot_inv_word_counts_ = std::move(compacted.slot_inv_word_counts_);
+	document_to_word_freqs_ = std::move(compacted.document_to_word_freqs_);
+	free_slots_ = std::move(compacted.free_slots_);
+	removed_slots_ = std::move(compacted.removed_slots_);
+	removed_slot_count_ = compacted.removed_slot_count_;
+	term_removed_document_counts_ = std::move(compacted.term_removed_document_counts_);
+	rating_index_ = std::move(compacted.rating_index_);
+	documents_ids_ = std::move(compacted.documents_ids_);
+	++index_epoch_; // Term IDs have changed
+}
+
+size_t SearchServer::GetWordCount() const
+{
+	return terms_.GetWordCount();
+}
+
+uint64_t SearchServer::GetIndexEpoch() const
+{
+	return index_epoch_;
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+	//LOG_DURATION_STREAM("Operation time: ", std::cout);
 	if (document_id < 0)
 	{
 		throw std::out_of_range("Document ID is negative"s);
 	}
-	if (documents_.count(document_id) == 0)
+	const uint32_t slot = GetSlot(document_id);
+	return MatchQuery(ParseQuery(raw_query, false), slot); //bool with_execution_policy
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy policy, std::string_view raw_query, int document_id) const
+{
+	return MatchDocument(raw_query, document_id);
+}
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const
+{
+	if (document_id < 0)
 	{
-		throw std::invalid_argument("Document ID is missing"s);
+		throw std::out_of_range("Document ID is negative"s);
 	}
-	if (!IsValidWord(raw_query))
+	const uint32_t slot = GetSlot(document_id);
+	return MatchQuery(GetQuery(query), slot);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy, const PreparedQuery& query, int document_id) const
+{
+	return MatchDocument(query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy, const PreparedQuery& query, int document_id) const
+{
+	return MatchDocument(query, document_id); // Without parsing there is too little work in one document to split it
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const
+{
+	if (document_id < 0)
 	{
-		throw std::invalid_argument("Invalid query"s);
+		throw std::out_of_range("Document ID is negative"s);
 	}
+	const uint32_t slot = GetSlot(document_id);
 
-	const SearchServer::Query& query = ParseQuery(raw_query, true); //bool with_execution_policy
-	const std::map<std::string_view, double>& word_and_frequency = document_to_word_freqs_.at(document_id);
+	const SearchServer::Query query = ParseQuery(raw_query, true); // A copy, the workers must not read the scratch of this thread
+	const std::map<TermId, double>& term_and_frequency = document_to_word_freqs_[slot];
 
-	if (std::any_of(policy, query.minus_words.begin(), query.minus_words.end(), [&word_and_frequency](const std::string_view minus_word)
+	if (std::any_of(policy, query.minus_terms.begin(), query.minus_terms.end(), [&term_and_frequency](const TermId minus_term)
 		{
-			return word_and_frequency.count(minus_word) > 0;
+			return term_and_frequency.count(minus_term) > 0;
 		}))
 	{
-		return { {}, documents_.at(document_id).status };
+		return { std::vector<std::string_view>{}, slot_statuses_[slot] };
 	}
-	std::vector<std::string_view> matched_words;
-	matched_words.reserve(query.plus_words.size());
-	auto last_copied_it = std::copy_if(policy, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), [&word_and_frequency](const std::string_view plus_word)
+	std::vector<TermId> matched_terms(query.plus_terms.size());
+	auto last_copied_it = std::copy_if(policy, query.plus_terms.begin(), query.plus_terms.end(), matched_terms.begin(), [&term_and_frequency](const TermId plus_term)
 		{
-			return word_and_frequency.count(plus_word) > 0;
+			return term_and_frequency.count(plus_term) > 0;
 		});
-	matched_words.erase(last_copied_it, matched_words.end());
-	std::sort(policy, matched_words.begin(), matched_words.end());
-	std::vector<std::string_view>::iterator it = std::unique(matched_words.begin(), matched_words.end());
-	matched_words.erase(it, matched_words.end());
-	return { matched_words, documents_.at(document_id).status };
+	matched_terms.erase(last_copied_it, matched_terms.end());
+	std::sort(policy, matched_terms.begin(), matched_terms.end());
+	matched_terms.erase(std::unique(matched_terms.begin(), matched_terms.end()), matched_terms.end());
+
+	std::vector<std::string_view> matched_words;
+	matched_words.reserve(matched_terms.size());
+	for (const TermId term_id : matched_terms)
+	{
+		matched_words.emplace_back(terms_.GetWord(term_id));
+	}
+	std::sort(matched_words.begin(), matched_words.end()); // Same alphabetical order as the sequential version
+	return { matched_words, slot_statuses_[slot] };
 }
 
 bool SearchServer::IsValidWord(std::string_view word)
@@ -181,31 +439,136 @@ bool SearchServer::IsStopWord(std::string_view word) const
 	return stop_words_.count(word) > 0;
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const
+int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
 {
-	std::vector<std::string_view> words;
-	for (const std::string_view word : SplitIntoWords(text))
+	if (ratings.empty())
 	{
-		if (!IsValidWord(word))
+		return 0;
+	}
+	int rating_sum = std::accumulate(ratings.begin(), ratings.end(), 0);
+	return rating_sum / static_cast<int>(ratings.size());
+}
+
+uint32_t SearchServer::GetSlot(int document_id) const
+{
+	const auto it = document_id_to_slot_.find(document_id);
+	if (it == document_id_to_slot_.end())
+	{
+		throw std::invalid_argument("Document ID is missing"s);
+	}
+	return it->second;
+}
+
+const PostingList& SearchServer::GetPostings(TermId term_id, uint32_t slot) const
+{
+	return word_to_document_freqs_[term_id][static_cast<size_t>(slot_statuses_[slot])];
+}
+
+PostingList& SearchServer::GetPostings(TermId term_id, uint32_t slot)
+{
+	return word_to_document_freqs_[term_id][static_cast<size_t>(slot_statuses_[slot])];
+}
+
+void SearchServer::CheckNewDocumentIds(const std::vector<DocumentRecord>& documents) const
+{
+	std::unordered_set<int> document_ids;
+	document_ids.reserve(documents.size());
+	for (const DocumentRecord& document : documents)
+	{
+		if (document.id < 0 || static_cast<bool>(document_id_to_slot_.count(document.id)) || !document_ids.insert(document.id).second)
 		{
-			throw invalid_argument("Invalid symbols in document"s);
+			throw invalid_argument("Wrong document ID"s);
 		}
-		if (!IsStopWord(word))
+	}
+}
+
+bool SearchServer::CountWords(std::string_view text, WordCounts& word_counts, size_t& word_count) const
+{
+	// The text is split once and its words are counted by a hash table before touching the index, so stop words are checked
+	// and words are interned once per distinct word rather than once per occurrence
+	thread_local std::vector<std::string_view> words;
+	if (!SplitIntoWords(text, words))
+	{
+		return false;
+	}
+	WordCounter& word_counter = WordCounter::ForCurrentThread();
+	word_counter.Reset(words.size());
+	for (const std::string_view word : words)
+	{
+		word_counter.Add(word);
+	}
+	word_counts.clear();
+	word_count = 0;
+	word_counter.ForEach([this, &word_counts, &word_count](std::string_view word, uint32_t count)
 		{
-			words.emplace_back(word);
-		}
+			if (!IsStopWord(word))
+			{
+				word_counts.emplace_back(word, count);
+				word_count += count;
+			}
+		});
+	return true;
+}
+
+void SearchServer::InternWords(const WordCounts& word_counts, TermCounts& term_counts)
+{
+	term_counts.clear();
+	for (const auto& [word, count] : word_counts)
+	{
+		term_counts.emplace_back(terms_.Intern(word), count); // The dictionary keeps its own copy of the word, the document text is not stored
 	}
-	return words;
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
+uint32_t SearchServer::AllocateSlot(int document_id, DocumentStatus status, int rating, double inv_word_count)
 {
-	if (ratings.empty())
+	uint32_t slot;
+	if (!free_slots_.empty())
 	{
-		return 0;
+		slot = free_slots_.back();
+		free_slots_.pop_back();
 	}
-	int rating_sum = std::accumulate(ratings.begin(), ratings.end(), 0);
-	return rating_sum / static_cast<int>(ratings.size());
+	else
+	{
+		slot = static_cast<uint32_t>(slot_document_ids_.size());
+		slot_document_ids_.emplace_back();
+		slot_statuses_.emplace_back();
+		slot_ratings_.emplace_back();
+		slot_inv_word_counts_.emplace_back();
+		document_to_word_freqs_.emplace_back();
+	}
+	slot_document_ids_[slot] = document_id;
+	slot_statuses_[slot] = status;
+	slot_ratings_[slot] = rating;
+	slot_inv_word_counts_[slot] = inv_word_count;
+	rating_index_[static_cast<size_t>(status)].emplace(rating, slot);
+	document_id_to_slot_.emplace(document_id, slot);
+	documents_ids_.insert(document_id);
+	return slot;
+}
+
+void SearchServer::DetachSlot(uint32_t slot)
+{
+	const int document_id = slot_document_ids_[slot];
+	rating_index_[static_cast<size_t>(slot_statuses_[slot])].erase({ slot_ratings_[slot], slot });
+	document_id_to_slot_.erase(document_id);
+	documents_ids_.erase(document_id);
+}
+
+void SearchServer::ReleaseUnusedTerm(TermId term_id)
+{
+	StatusPostings& status_postings = word_to_document_freqs_[term_id];
+	if (std::all_of(status_postings.begin(), status_postings.end(), [](const PostingList& postings) { return postings.Empty(); }))
+	{
+		status_postings = StatusPostings{}; // Erased postings may leave empty blocks and buffers behind
+		terms_.Release(term_id);
+	}
+}
+
+void SearchServer::ReleaseSlot(uint32_t slot)
+{
+	// Postings of the slot must be erased by now, the slot itself is kept for the next added document
+	document_to_word_freqs_[slot].clear();
+	free_slots_.push_back(slot);
 }
 
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const
@@ -224,51 +587,313 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 			text = text.substr(1);
 		}
 	}
-	if (!IsValidWord(text))
-	{
-		throw std::invalid_argument("Invalid query"s);
-	}
 	return { text, is_minus, IsStopWord(text) }; // Write all data to the QueryWord structure
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool with_execution_policy) const
+SearchServer::QueryScratch& SearchServer::QueryScratch::ForCurrentThread()
+{
+	thread_local QueryScratch scratch;
+	return scratch;
+}
+
+void SearchServer::ParseQueryWords(std::string_view text, bool with_execution_policy, QueryWords& query_words) const
 {
-	SearchServer::Query query;
-	for (const std::string_view word : SplitIntoWords(text))
+	thread_local std::vector<std::string_view> words; // Reused by the next queries of the thread, as the other scratch of the search
+	if (!SplitIntoWords(text, words)) // Control characters are found by the split, the words are not checked again
+	{
+		throw std::invalid_argument("Invalid query"s);
+	}
+	std::vector<std::string_view>& plus_words = query_words.plus_words;
+	std::vector<std::string_view>& minus_words = query_words.minus_words;
+	plus_words.clear();
+	minus_words.clear();
+	for (const std::string_view word : words)
 	{
 		const SearchServer::QueryWord query_word = ParseQueryWord(word);
 		if (!query_word.is_stop)
 		{
 			if (query_word.is_minus)
 			{
-				query.minus_words.push_back(query_word.data);
+				minus_words.push_back(query_word.data);
 			}
 			else
 			{
-				query.plus_words.push_back(query_word.data);
+				plus_words.push_back(query_word.data);
 			}
 		}
 	}
 	if (!with_execution_policy)
 	{
-		std::sort(query.minus_words.begin(), query.minus_words.end());
-		std::sort(query.plus_words.begin(), query.plus_words.end());
-
-		auto last_minus = std::unique(query.minus_words.begin(), query.minus_words.end());
-		auto last_plus = std::unique(query.plus_words.begin(), query.plus_words.end());
+		// Words are ordered by text rather than by ID, so relevance is summed in the same order as before
+		std::sort(minus_words.begin(), minus_words.end());
+		std::sort(plus_words.begin(), plus_words.end());
 
-		size_t newSize = last_minus - query.minus_words.begin();
-		query.minus_words.resize(newSize);
+		minus_words.erase(std::unique(minus_words.begin(), minus_words.end()), minus_words.end());
+		plus_words.erase(std::unique(plus_words.begin(), plus_words.end()), plus_words.end());
+	}
+}
 
-		newSize = last_plus - query.plus_words.begin();
-		query.plus_words.resize(newSize);
+void SearchServer::ResolveQuery(const QueryWords& words, Query& query, const std::vector<double>& plus_word_inverse_document_freqs) const
+{
+	query.plus_terms.clear();
+	query.minus_terms.clear();
+	query.plus_inverse_document_freqs.clear();
+	query.removed_slots = nullptr;
+	for (const std::string_view word : words.minus_words)
+	{
+		if (const auto term_id = terms_.Find(word))
+		{
+			query.minus_terms.push_back(*term_id);
+		}
 	}
+	for (size_t word_index = 0; word_index < words.plus_words.size(); ++word_index)
+	{
+		if (const auto term_id = terms_.Find(words.plus_words[word_index]))
+		{
+			query.plus_terms.push_back(*term_id);
+			query.plus_inverse_document_freqs.push_back(plus_word_inverse_document_freqs.empty() ? ComputeWordInverseDocumentFreq(*term_id) : plus_word_inverse_document_freqs[word_index]);
+		}
+	}
+}
+
+const SearchServer::Query& SearchServer::ParseQuery(std::string_view text, bool with_execution_policy) const
+{
+	QueryScratch& scratch = QueryScratch::ForCurrentThread();
+	ParseQueryWords(text, with_execution_policy, scratch.words);
+	ResolveQuery(scratch.words, scratch.query);
+	return scratch.query;
+}
+
+SearchServer::PreparedQuery SearchServer::PrepareQuery(std::string_view raw_query) const
+{
+	QueryWords& words = QueryScratch::ForCurrentThread().words;
+	ParseQueryWords(raw_query, false, words);
+	PreparedQuery query;
+	query.server_ = this;
+	query.index_epoch_ = index_epoch_;
+	query.plus_words_.assign(words.plus_words.begin(), words.plus_words.end());
+	query.minus_words_.assign(words.minus_words.begin(), words.minus_words.end());
+	ResolveQuery(words, query.query_);
 	return query;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const
+std::string SearchServer::NormalizeQuery(std::string_view raw_query) const
+{
+	// Words have no spaces and control characters and do not start with a dash, so the parts cannot run into each other
+	QueryWords& words = QueryScratch::ForCurrentThread().words;
+	ParseQueryWords(raw_query, false, words);
+	std::string text;
+	for (const std::string_view word : words.plus_words)
+	{
+		text += word;
+		text.push_back(' ');
+	}
+	for (const std::string_view word : words.minus_words)
+	{
+		text.push_back('-');
+		text += word;
+		text.push_back(' ');
+	}
+	return text;
+}
+
+const SearchServer::Query& SearchServer::GetQuery(const PreparedQuery& query) const
+{
+	if (query.server_ == this && query.index_epoch_ == index_epoch_ && query.plus_inverse_document_freqs_.empty())
+	{
+		return query.query_;
+	}
+	// The words are already checked and sorted, only their IDs and IDFs may have changed
+	QueryScratch& scratch = QueryScratch::ForCurrentThread();
+	scratch.words.plus_words.assign(query.plus_words_.begin(), query.plus_words_.end());
+	scratch.words.minus_words.assign(query.minus_words_.begin(), query.minus_words_.end());
+	ResolveQuery(scratch.words, scratch.query, query.plus_inverse_document_freqs_);
+	return scratch.query;
+}
+
+const SearchServer::Query& SearchServer::GetMarkedQuery(const PreparedQuery& query, const std::vector<bool>& removed_slots) const
+{
+	Query& scratch_query = QueryScratch::ForCurrentThread().query;
+	if (&GetQuery(query) != &scratch_query)
+	{
+		scratch_query = query.query_; // The vectors of the scratch keep their memory
+	}
+	scratch_query.removed_slots = &removed_slots;
+	return scratch_query;
+}
+
+const std::vector<std::string>& SearchServer::PreparedQuery::GetPlusWords() const
+{
+	return plus_words_;
+}
+
+const std::vector<std::string>& SearchServer::PreparedQuery::GetMinusWords() const
 {
-	return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+	return minus_words_;
+}
+
+void SearchServer::PreparedQuery::SetStatistics(const QueryStatistics& statistics)
+{
+	if (statistics.plus_word_document_counts.size() != plus_words_.size())
+	{
+		throw std::invalid_argument("Statistics do not match the query"s);
+	}
+	for (const int document_freq : statistics.plus_word_document_counts)
+	{
+		if (document_freq <= 0 || document_freq > statistics.document_count)
+		{
+			throw std::invalid_argument("Invalid document frequency"s);
+		}
+	}
+	// The same formula as ComputeWordInverseDocumentFreq, so one server with all the documents would get the same values
+	plus_inverse_document_freqs_.clear();
+	for (const int document_freq : statistics.plus_word_document_counts)
+	{
+		plus_inverse_document_freqs_.push_back(std::log(statistics.document_count * 1.0 / document_freq));
+	}
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchQuery(const Query& query, uint32_t slot) const
+{
+	std::vector<std::string_view> matched_words;
+	for (const TermId term_id : query.minus_terms)
+	{
+		if (GetPostings(term_id, slot).Contains(slot))
+		{
+			return { matched_words, slot_statuses_[slot] };
+		}
+	}
+	for (const TermId term_id : query.plus_terms)
+	{
+		if (GetPostings(term_id, slot).Contains(slot))
+		{
+			matched_words.emplace_back(terms_.GetWord(term_id));
+		}
+	}
+	return { matched_words, slot_statuses_[slot] };
+}
+
+size_t SearchServer::GetDocumentFreq(TermId term_id) const
+{
+	size_t document_freq = 0; // Documents of all statuses count, whatever the query filters
+	for (const PostingList& postings : word_to_document_freqs_[term_id])
+	{
+		document_freq += postings.Size();
+	}
+	if (term_id < term_removed_document_counts_.size())
+	{
+		document_freq -= term_removed_document_counts_[term_id];
+	}
+	return document_freq;
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const
+{
+	return std::log(GetDocumentCount() * 1.0 / GetDocumentFreq(term_id));
+}
+
+const std::vector<bool>& SearchServer::FindExcludedSlots(const Query& query, const StatusSet& statuses) const
+{
+	std::vector<bool>& excluded_slots = QueryScratch::ForCurrentThread().excluded_slots;
+	excluded_slots.clear();
+	if (query.minus_terms.empty())
+	{
+		return excluded_slots;
+	}
+	excluded_slots.resize(slot_document_ids_.size());
+	for (const TermId term_id : query.minus_terms)
+	{
+		for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status)
+		{
+			if (!statuses.test(status))
+			{
+				continue;
+			}
+			word_to_document_freqs_[term_id][status].ForEach([&excluded_slots](int slot, uint32_t)
+				{
+					excluded_slots[slot] = true;
+				});
+		}
+	}
+	return excluded_slots;
+}
+
+bool SearchServer::IsExcluded(const Query& query, const std::vector<bool>& excluded_slots, uint32_t slot) const
+{
+	// Slots added after the marks were made are past their end
+	return (!excluded_slots.empty() && excluded_slots[slot]) || (slot < removed_slots_.size() && removed_slots_[slot])
+		|| (query.removed_slots && slot < query.removed_slots->size() && (*query.removed_slots)[slot]);
+}
+
+bool SearchServer::FindFilteredSlots(const Query& query, const DocumentFilter& filter, std::vector<uint32_t>& slots) const
+{
+	size_t posting_count = 0;
+	for (const TermId term_id : query.plus_terms)
+	{
+		for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status)
+		{
+			if (filter.statuses.test(status))
+			{
+				posting_count += word_to_document_freqs_[term_id][status].Size();
+			}
+		}
+	}
+	const size_t max_slot_count = posting_count / (filtered_slot_cost_ * std::max<size_t>(1, query.plus_terms.size()));
+
+	for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status)
+	{
+		if (!filter.statuses.test(status) || filter.min_rating > filter.max_rating)
+		{
+			continue;
+		}
+		const std::set<std::pair<int, uint32_t>>& ratings = rating_index_[status];
+		for (auto it = ratings.lower_bound({ filter.min_rating, 0 }); it != ratings.end() && it->first <= filter.max_rating; ++it)
+		{
+			if (slots.size() == max_slot_count)
+			{
+				return false;
+			}
+			slots.push_back(it->second);
+		}
+	}
+	return true;
+}
+
+std::vector<Document> SearchServer::FindFilteredDocuments(const Query& query, const std::vector<uint32_t>& slots, size_t max_result_count) const
+{
+	// The slots are scattered over the posting lists, so their words are looked up in the forward index
+	// instead of decoding a block of postings for each of them
+	TopDocuments& top_documents = QueryScratch::ForCurrentThread().top_documents;
+	top_documents.Reset(max_result_count);
+	for (const uint32_t slot : slots)
+	{
+		const std::map<TermId, double>& term_freqs = document_to_word_freqs_[slot];
+		if (std::any_of(query.minus_terms.begin(), query.minus_terms.end(), [&term_freqs](const TermId term_id)
+			{
+				return term_freqs.count(term_id) > 0;
+			}))
+		{
+			continue;
+		}
+
+		// Summed in the order of the query words, as the other versions do it
+		double relevance = 0.0;
+		bool is_matched = false;
+		for (size_t term_index = 0; term_index < query.plus_terms.size(); ++term_index)
+		{
+			const auto it = term_freqs.find(query.plus_terms[term_index]);
+			if (it != term_freqs.end())
+			{
+				relevance += it->second * query.plus_inverse_document_freqs[term_index];
+				is_matched = true;
+			}
+		}
+		if (is_matched)
+		{
+			top_documents.Add({ slot_document_ids_[slot], relevance, slot_ratings_[slot] });
+		}
+	}
+	return top_documents.Extract();
 }
 
 void AddDocument(SearchServer& search_server, int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings)
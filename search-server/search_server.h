@@ -1,9 +1,20 @@
 #pragma once
 #include "document.h"
+#include "document_filter.h"
 #include "log_duration.h"
-#include "concurrent_map.h"
+#include "score_accumulator.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "posting_list.h"
+#include "top_documents.h"
+#include "word_counter.h"
+#include <unordered_map>
+#include <bitset>
+#include <array>
 #include <type_traits>
+#include <limits>
+#include <numeric>
+#include <thread>
 #include <string_view>
 #include <algorithm>
 #include <execution>
@@ -14,8 +25,21 @@
 #include <set>
 
 
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-constexpr double EPSILON = 1e-6;
+const int MAX_RESULT_DOCUMENT_COUNT = 5; // Default number of documents returned by FindTopDocuments
+
+// Passed to FindTopDocuments instead of an execution policy to score documents one at a time with Block-Max WAND.
+// Documents that cannot enter the top are skipped by the upper bounds of the posting lists, the result is the same
+struct BlockMaxWandPolicy {};
+inline constexpr BlockMaxWandPolicy BLOCK_MAX_WAND{};
+
+// A document added by SearchServer::AddDocuments, the text is only read during the call
+struct DocumentRecord
+{
+	int id = 0;
+	std::string_view text;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+};
 
 class SearchServer
 {
@@ -35,47 +59,131 @@ public:
 	std::set<int>::iterator begin();
 	std::set<int>::iterator end();
 
-	const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+	std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
 	void RemoveDocument(int document_id);
 	template <typename ExecutionPolicy>
 	void RemoveDocument(ExecutionPolicy&& policy, int document_id);
 
+	// Removes documents at once without touching the postings: they leave the results, the IDs and the rating index immediately,
+	// while their postings stay marked in a bitmap until PurgeRemovedDocuments. Throws before removing anything if an ID is missing or repeated
+	void RemoveDocuments(const std::vector<int>& document_ids);
+	// Erases the postings of documents removed by RemoveDocuments, every posting list holding any of them is rewritten once.
+	// With the parallel policy the lists are rewritten in parallel. Results do not change, so the index epoch stays the same
+	template <typename ExecutionPolicy>
+	void PurgeRemovedDocuments(ExecutionPolicy&& policy);
+	void PurgeRemovedDocuments();
+	size_t GetRemovedDocumentCount() const; // Removed by RemoveDocuments and not purged yet
+
 	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+	// Builds the same index as AddDocument called for the documents in turn. With the parallel policy the words of the documents
+	// are counted and the posting lists are written in parallel, only new words get their IDs one document after another.
+	// Throws before adding anything if any ID or text is invalid
+	template <typename ExecutionPolicy>
+	void AddDocuments(ExecutionPolicy&& policy, const std::vector<DocumentRecord>& documents);
+	void AddDocuments(const std::vector<DocumentRecord>& documents);
+
+	// max_result_count is the size of the result page, the top documents are selected without sorting all matched ones
 	template <typename DocumentPredicate, typename ExecutionPolicy>
-	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	template <typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	// A selective filter is resolved by the rating index first and costs as much as the documents it selects, not the postings
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
 	template <typename ExecutionPolicy>
-	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const;
-	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
 	template <typename ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
 	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
 
+	class PreparedQuery;
+	PreparedQuery PrepareQuery(std::string_view raw_query) const; // Parses and checks the query once, throws as FindTopDocuments does
+	// The sorted plus words and then the sorted minus words with their dashes, without repeats and stop words. Queries with the same
+	// text find the same documents. Checks the query as PrepareQuery does, but the words are not looked up in the index
+	std::string NormalizeQuery(std::string_view raw_query) const;
+
+	// The same searches for a prepared query, which is not parsed again
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, const DocumentFilter& filter, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, const DocumentFilter& filter, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query) const;
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+
+	// For an owner that must not change the server and keeps its removals aside: documents marked in removed_slots are skipped
+	// with one bit test per posting. The marks come from MarkDocumentSlots and must outlive the search
+	std::vector<bool> MarkDocumentSlots(const std::set<int>& document_ids) const; // Absent documents are not marked
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, const std::vector<bool>& removed_slots, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(const PreparedQuery& query, const std::vector<bool>& removed_slots, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
 	int GetDocumentCount() const;
+	bool HasDocument(int document_id) const;
+	size_t GetPostingCount() const; // Postings of removed documents count until they are purged
+	size_t GetPostingsMemoryUsage() const; // Bytes taken by the posting lists of all terms
+	uint64_t GetIndexEpoch() const; // Changes whenever a document is added or removed, so results of the same query may differ
 
 	using MatchedDocumentsContainer = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 	MatchedDocumentsContainer MatchDocument(std::string_view raw_query, int document_id) const; // Returns matched words in exact document
 	MatchedDocumentsContainer MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const;
 	MatchedDocumentsContainer MatchDocument(std::execution::sequenced_policy policy, std::string_view raw_query, int document_id) const;
+	MatchedDocumentsContainer MatchDocument(const PreparedQuery& query, int document_id) const;
+	MatchedDocumentsContainer MatchDocument(std::execution::parallel_policy policy, const PreparedQuery& query, int document_id) const;
+	MatchedDocumentsContainer MatchDocument(std::execution::sequenced_policy policy, const PreparedQuery& query, int document_id) const;
 
-	struct DocumentData
+	// Document counts behind the IDFs of a query. Servers holding parts of one corpus add theirs up and give the sums
+	// to PreparedQuery::SetStatistics, then each of them scores its documents as one server with the whole corpus would
+	struct QueryStatistics
 	{
-		int rating = 0;
-		DocumentStatus status;
-		std::string document_text_;
+		int document_count = 0;
+		std::vector<int> plus_word_document_counts; // In the order of PreparedQuery::GetPlusWords
 	};
+	QueryStatistics GetQueryStatistics(const PreparedQuery& query) const;
+
+	// Copies in the documents of another server with the same stop words, except the removed ones. Their term counts are taken
+	// from the index, so the documents are scored as if they were added here. Throws before copying if an ID is taken
+	void MergeDocuments(const SearchServer& other, const std::set<int>& removed_document_ids = {});
+	void ShrinkToFit(); // Compresses all posting lists and releases spare memory, for a server that is not going to change
+	// Rebuilds the index from its documents after heavy churn: removed documents are purged, term IDs and slots become dense
+	// and every table and posting list gets only the memory it needs. Results stay the same, prepared queries are resolved again
+	void Compact();
+	size_t GetWordCount() const; // Distinct words of the documents, a word is forgotten once the postings of its last document are erased
 private:
 
 	const std::set<std::string, std::less<>> stop_words_; // These words do not participate in the indexing of documents added by AddDocument, these words are not included in the search
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_; // Table of [words]: IDs and Term Frequencies
-	std::map<int, std::map<std::string_view, double>> document_to_word_freqs_; // Table of [IDs]: words and Term Frequencies
-	std::map<int, DocumentData> documents_;
-	std::set<int> documents_ids_; // set of document IDs
+	TermDictionary terms_; // Owns the words of all documents, the indexes below refer to them by term ID
+	// Postings of a term are split by document status, so a query filtered by status never reads documents of the others
+	using StatusPostings = std::array<PostingList, DOCUMENT_STATUS_COUNT>;
+	std::vector<StatusPostings> word_to_document_freqs_; // Table of [term IDs][statuses]: compressed slots and term counts
+
+	// Documents live in dense slots, the tables below are indexed by slot and document IDs are translated only at the API boundary
+	std::unordered_map<int, uint32_t> document_id_to_slot_;
+	std::vector<int> slot_document_ids_;
+	std::vector<DocumentStatus> slot_statuses_;
+	std::vector<int> slot_ratings_;
+	std::vector<double> slot_inv_word_counts_; // Postings keep term counts, TF is restored as term count * inverse word count
+	std::vector<std::map<TermId, double>> document_to_word_freqs_; // Table of [slots]: term IDs and Term Frequencies
+	std::vector<uint32_t> free_slots_; // Slots of removed documents, AddDocument takes them before growing the tables
+	std::vector<bool> removed_slots_; // One bit per slot, set for documents of RemoveDocuments still in the postings. Empty after a purge
+	size_t removed_slot_count_ = 0;
+	std::vector<uint32_t> term_removed_document_counts_; // Table of [term IDs]: removed documents still in the postings of the term
+	std::array<std::set<std::pair<int, uint32_t>>, DOCUMENT_STATUS_COUNT> rating_index_; // Table of [statuses]: ratings and slots, ordered by rating
+	uint64_t index_epoch_ = 0; // Changed by every added or removed document, term IDs and IDFs of older prepared queries are looked up again
+	std::set<int> documents_ids_; // set of document IDs, keeps begin() and end() ordered
 
 	static bool IsValidWord(std::string_view word);
 
@@ -83,10 +191,28 @@ private:
 
 	static bool ContainsInvalidDashes(std::string_view word);
 
-	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
-
 	static int ComputeAverageRating(const std::vector<int>& ratings);
 
+	uint32_t GetSlot(int document_id) const; // Throws if there is no such document
+	const PostingList& GetPostings(TermId term_id, uint32_t slot) const; // The partition of the term for the status of the slot
+	PostingList& GetPostings(TermId term_id, uint32_t slot);
+	uint32_t AllocateSlot(int document_id, DocumentStatus status, int rating, double inv_word_count);
+	void CheckNewDocumentIds(const std::vector<DocumentRecord>& documents) const; // Throws if an ID is negative, taken or repeated
+
+	using WordCounts = std::vector<std::pair<std::string_view, uint32_t>>;
+	using TermCounts = std::vector<std::pair<TermId, uint32_t>>;
+	// Distinct words of the text except stop words with their counts, in the order of their first occurrence, and the number of these words.
+	// Returns false if the text has control characters
+	bool CountWords(std::string_view text, WordCounts& word_counts, size_t& word_count) const;
+	void InternWords(const WordCounts& word_counts, TermCounts& term_counts); // New words get IDs in the order of word_counts
+	void DetachSlot(uint32_t slot); // Takes the document out of the IDs and the rating index, its postings and forward index stay
+	void ReleaseSlot(uint32_t slot); // Frees a detached slot whose postings are already erased
+	void ReleaseUnusedTerm(TermId term_id); // Forgets the word of the term if it has no postings left, so the dictionary keeps no dead words
+
+	static constexpr size_t ranges_per_thread_ = 4; // Parallel search splits the slots finer than the thread count to even out the load
+	static constexpr size_t min_slots_per_range_ = 4096; // Smaller ranges cost more to schedule than to score
+	static constexpr size_t filtered_slot_cost_ = 8; // Looking a word of a filtered slot up in the forward index costs about as much as reading 8 postings
+
 	struct QueryWord
 	{
 		std::string_view data;
@@ -94,24 +220,79 @@ private:
 		bool is_stop;
 	};
 
-	QueryWord ParseQueryWord(std::string_view text) const;
+	QueryWord ParseQueryWord(std::string_view text) const; // Control characters must be already checked by the split of the query
 
-	struct Query
+	struct QueryWords
 	{
 		std::vector<std::string_view> plus_words;
-		std::vector<std::string_view> minus_words; // Documents with these words will not be returned as a result of the search query
+		std::vector<std::string_view> minus_words;
+	};
+
+	struct Query
+	{
+		std::vector<TermId> plus_terms;
+		std::vector<TermId> minus_terms; // Documents with these words will not be returned as a result of the search query
+		std::vector<double> plus_inverse_document_freqs; // IDF of each of plus_terms, computed when the query is resolved
+		const std::vector<bool>* removed_slots = nullptr; // Removal marks of the caller, see MarkDocumentSlots
+	};
+
+	// Buffers of a query reused by the next queries of the thread, so a warm thread allocates only the results of a sequential search.
+	// A thread waiting for parallel workers may run another query meanwhile, so the parallel versions copy what their workers read
+	struct QueryScratch
+	{
+		QueryWords words;
+		Query query;
+		std::vector<bool> excluded_slots;
+		std::vector<uint32_t> filtered_slots;
+		TopDocuments top_documents{ 0 };
+		// Block-Max WAND cursors with the IDFs and relevance bounds of their terms, and the cursors sorted by their current slot
+		std::vector<PostingList::Cursor> cursors;
+		std::vector<double> cursor_inverse_document_freqs;
+		std::vector<double> cursor_max_relevances;
+		std::vector<size_t> cursor_order;
+
+		static QueryScratch& ForCurrentThread();
 	};
 
-	Query ParseQuery(std::string_view text, bool without_execution_policy) const;
+	void ParseQueryWords(std::string_view text, bool with_execution_policy, QueryWords& words) const; // Sorted and without repeats unless with_execution_policy
+	// Words missing from the dictionary are dropped. IDFs of the plus words may be given instead of computed here
+	void ResolveQuery(const QueryWords& words, Query& query, const std::vector<double>& plus_word_inverse_document_freqs = {}) const;
+	const Query& ParseQuery(std::string_view text, bool with_execution_policy) const; // Into the scratch of the thread
+	// The prepared query itself if the index is the same and it has no statistics of its own, otherwise resolved again into the scratch of the thread
+	const Query& GetQuery(const PreparedQuery& query) const;
+	const Query& GetMarkedQuery(const PreparedQuery& query, const std::vector<bool>& removed_slots) const; // In the scratch of the thread, the prepared query is shared
+
+	size_t GetDocumentFreq(TermId term_id) const; // Documents of all statuses with the term, removed ones are not counted
+	double ComputeWordInverseDocumentFreq(TermId term_id) const;
+
+	MatchedDocumentsContainer MatchQuery(const Query& query, uint32_t slot) const;
+
+	// One bit per slot, set for documents of the given statuses with any of the minus words, in the scratch of the thread. Empty if the query has none
+	const std::vector<bool>& FindExcludedSlots(const Query& query, const StatusSet& statuses) const;
+	// Whether the slot has a minus word, is removed and not purged yet or is marked by the caller. The marks are read as they are
+	bool IsExcluded(const Query& query, const std::vector<bool>& excluded_slots, uint32_t slot) const;
 
-	double ComputeWordInverseDocumentFreq(std::string_view word) const;
+	// Collects slots passing the filter from the rating index.
+	// Returns false and gives up once scoring them would cost more than reading the postings of the query
+	bool FindFilteredSlots(const Query& query, const DocumentFilter& filter, std::vector<uint32_t>& slots) const;
+	std::vector<Document> FindFilteredDocuments(const Query& query, const std::vector<uint32_t>& slots, size_t max_result_count) const;
+
+	// Searches shared by raw and prepared queries
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopQueryDocuments(ExecutionPolicy&& policy, const Query& query, const DocumentFilter& filter, size_t max_result_count) const;
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopQueryDocuments(ExecutionPolicy&& policy, const Query& query, DocumentStatus status, size_t max_result_count) const;
 
+	// Return max_result_count most relevant documents, ordered by IsMoreRelevant.
+	// Only the posting partitions of the given statuses are read, the predicate is checked for the documents found there
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindAllDocuments(const Query& query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const;
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy, const Query& query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const;
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy, const Query& query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindAllDocuments(const BlockMaxWandPolicy, const Query& query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const;
 };
 
 template <typename StringContainer>
@@ -127,73 +308,207 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 template<typename ExecutionPolicy>
 void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id)
 {
-	if (!document_to_word_freqs_.count(document_id))
+	if (!document_id_to_slot_.count(document_id))
 	{
 		throw std::invalid_argument("Invalid ID for deleting");
 	}
-	const std::map<std::string_view, double>& word_n_freqs = document_to_word_freqs_.at(document_id);
-	std::vector<std::string_view*> words_to_delete(word_n_freqs.size());
+	const uint32_t slot = document_id_to_slot_.at(document_id);
+	const std::map<TermId, double>& term_n_freqs = document_to_word_freqs_[slot];
+	std::vector<TermId> terms_to_delete(term_n_freqs.size());
 
 	std::transform(policy,
-		word_n_freqs.begin(), word_n_freqs.end(),
-		words_to_delete.begin(),
+		term_n_freqs.begin(), term_n_freqs.end(),
+		terms_to_delete.begin(),
 		[](const auto& element)
 		{
-			return const_cast<std::string_view*>(&element.first);
+			return element.first;
 		}
 	);
 
 	std::for_each(policy,
-		words_to_delete.begin(), words_to_delete.end(),
-		[this, document_id](std::string_view* word)
+		terms_to_delete.begin(), terms_to_delete.end(),
+		[this, slot](TermId term_id)
 		{
-			word_to_document_freqs_.at(*word).erase(document_id);
+			GetPostings(term_id, slot).Erase(slot); // Every term has its own posting lists, so no two threads touch the same one
 		});
+	for (const TermId term_id : terms_to_delete)
+	{
+		ReleaseUnusedTerm(term_id);
+	}
 
-	document_to_word_freqs_.erase(document_id);
-	documents_.erase(document_id);
-	documents_ids_.erase(document_id);
+	DetachSlot(slot);
+	ReleaseSlot(slot);
+	++index_epoch_;
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const
+template <typename ExecutionPolicy>
+void SearchServer::PurgeRemovedDocuments(ExecutionPolicy&& policy)
 {
-	constexpr bool is_par_execution = std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>;
-	const Query& query = ParseQuery(raw_query, is_par_execution);
-	auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+	if (removed_slot_count_ == 0)
+	{
+		return;
+	}
+	// Partitions holding removed documents are found by the forward index, so the other posting lists are not even decoded
+	std::vector<uint32_t> slots;
+	slots.reserve(removed_slot_count_);
+	std::vector<StatusSet> term_statuses(word_to_document_freqs_.size());
+	for (uint32_t slot = 0; slot < removed_slots_.size(); ++slot)
+	{
+		if (removed_slots_[slot])
+		{
+			slots.push_back(slot);
+			for (const auto& [term_id, term_freq] : document_to_word_freqs_[slot])
+			{
+				term_statuses[term_id].set(static_cast<size_t>(slot_statuses_[slot]));
+			}
+		}
+	}
+	std::vector<TermId> term_ids;
+	for (TermId term_id = 0; term_id < term_statuses.size(); ++term_id)
+	{
+		if (term_statuses[term_id].any())
+		{
+			term_ids.push_back(term_id);
+		}
+	}
 
-	std::sort(policy, matched_documents.begin(), matched_documents.end(),
-		[](const Document& lhs, const Document& rhs)
+	std::for_each(policy, term_ids.begin(), term_ids.end(), [this, &term_statuses](TermId term_id)
 		{
-			if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+			for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status)
 			{
-				return lhs.rating > rhs.rating;
+				if (term_statuses[term_id].test(status))
+				{
+					word_to_document_freqs_[term_id][status].EraseMarked(removed_slots_); // Every term has its own posting lists
+				}
 			}
-			else
+		});
+	for (const TermId term_id : term_ids)
+	{
+		ReleaseUnusedTerm(term_id);
+	}
+
+	for (const uint32_t slot : slots)
+	{
+		ReleaseSlot(slot);
+	}
+	removed_slots_.clear();
+	removed_slot_count_ = 0;
+	term_removed_document_counts_.clear();
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::AddDocuments(ExecutionPolicy&& policy, const std::vector<DocumentRecord>& documents)
+{
+	CheckNewDocumentIds(documents);
+	std::vector<size_t> document_indexes(documents.size());
+	std::iota(document_indexes.begin(), document_indexes.end(), 0);
+
+	// Documents are split and counted independently, an exception must not leave a parallel algorithm, so a bad text is only marked
+	std::vector<WordCounts> document_word_counts(documents.size());
+	std::vector<size_t> word_counts(documents.size());
+	std::vector<char> is_valid(documents.size());
+	std::for_each(policy, document_indexes.begin(), document_indexes.end(), [this, &documents, &document_word_counts, &word_counts, &is_valid](size_t index)
+		{
+			is_valid[index] = CountWords(documents[index].text, document_word_counts[index], word_counts[index]);
+		});
+	if (std::find(is_valid.begin(), is_valid.end(), 0) != is_valid.end())
+	{
+		throw std::invalid_argument("Invalid symbols in document");
+	}
+
+	// IDs of new words and slots depend on the order of the documents, so they are given one document after another
+	std::vector<TermCounts> document_term_counts(documents.size());
+	std::vector<uint32_t> slots(documents.size());
+	for (size_t index = 0; index < documents.size(); ++index)
+	{
+		const DocumentRecord& document = documents[index];
+		InternWords(document_word_counts[index], document_term_counts[index]);
+		slots[index] = AllocateSlot(document.id, document.status, ComputeAverageRating(document.ratings), 1.0 / word_counts[index]);
+	}
+	word_to_document_freqs_.resize(terms_.GetTermCount());
+
+	// Every document has its own slot in the forward index
+	std::for_each(policy, document_indexes.begin(), document_indexes.end(), [this, &document_term_counts, &slots](size_t index)
+		{
+			TermCounts& term_counts = document_term_counts[index];
+			std::sort(term_counts.begin(), term_counts.end());
+			const uint32_t slot = slots[index];
+			std::map<TermId, double>& term_freqs = document_to_word_freqs_[slot];
+			for (const auto& [term_id, term_count] : term_counts)
 			{
-				return lhs.relevance > rhs.relevance;
+				term_freqs.emplace_hint(term_freqs.end(), term_id, term_count * slot_inv_word_counts_[slot]);
 			}
 		});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+
+	// Postings are grouped by term and every term gets its documents in the order of the batch, as AddDocument would add them.
+	// Every term has its own posting lists, so the groups are written in parallel
+	struct BatchPosting
+	{
+		TermId term_id;
+		uint32_t document_index;
+		uint32_t term_count;
+	};
+	std::vector<BatchPosting> postings;
+	postings.reserve(std::transform_reduce(document_term_counts.begin(), document_term_counts.end(), size_t(0), std::plus<>(), [](const TermCounts& term_counts)
+		{
+			return term_counts.size();
+		}));
+	for (size_t index = 0; index < documents.size(); ++index)
 	{
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+		for (const auto& [term_id, term_count] : document_term_counts[index])
+		{
+			postings.push_back({ term_id, static_cast<uint32_t>(index), term_count });
+		}
 	}
-	return matched_documents;
+	std::sort(policy, postings.begin(), postings.end(), [](const BatchPosting& lhs, const BatchPosting& rhs)
+		{
+			return std::tie(lhs.term_id, lhs.document_index) < std::tie(rhs.term_id, rhs.document_index);
+		});
+	std::vector<size_t> term_begins;
+	for (size_t i = 0; i < postings.size(); ++i)
+	{
+		if (i == 0 || postings[i].term_id != postings[i - 1].term_id)
+		{
+			term_begins.push_back(i);
+		}
+	}
+	term_begins.push_back(postings.size());
+	std::vector<size_t> term_indexes(term_begins.size() - 1);
+	std::iota(term_indexes.begin(), term_indexes.end(), 0);
+	std::for_each(policy, term_indexes.begin(), term_indexes.end(), [this, &postings, &slots, &term_begins](size_t term_index)
+		{
+			for (size_t i = term_begins[term_index]; i < term_begins[term_index + 1]; ++i)
+			{
+				const uint32_t slot = slots[postings[i].document_index];
+				GetPostings(postings[i].term_id, slot).Add(slot, postings[i].term_count, postings[i].term_count * slot_inv_word_counts_[slot]);
+			}
+		});
+	index_epoch_ += documents.size();
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	const Query& query = ParseQuery(raw_query, false); // Repeated words must be scored once by both versions
+	return FindAllDocuments(policy, query, StatusSet().set(), document_predicate, max_result_count); // Any status may pass a predicate
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const
 {
-	return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate, max_result_count);
 }
 
 template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, const DocumentFilter& filter, size_t max_result_count) const
 {
-	return FindTopDocuments(policy, raw_query, [&status](int document_id, DocumentStatus document_status, int rating)
-		{
-			return document_status == status;
-		});
+	return FindTopQueryDocuments(policy, ParseQuery(raw_query, false), filter, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status, size_t max_result_count) const
+{
+	return FindTopQueryDocuments(policy, ParseQuery(raw_query, false), status, max_result_count);
 }
 
 template <typename ExecutionPolicy>
@@ -202,96 +517,322 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, s
 	return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	return FindAllDocuments(policy, GetQuery(query), StatusSet().set(), document_predicate, max_result_count);
+}
+
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_count) const
 {
-	//LOG_DURATION_STREAM("Operation time: ", std::cout);
-	std::map<int, double> document_to_relevance;
-	for (const std::string_view word : query.plus_words)
+	return FindTopDocuments(std::execution::seq, query, document_predicate, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, const DocumentFilter& filter, size_t max_result_count) const
+{
+	return FindTopQueryDocuments(policy, GetQuery(query), filter, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentStatus status, size_t max_result_count) const
+{
+	return FindTopQueryDocuments(policy, GetQuery(query), status, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query) const
+{
+	return FindTopDocuments(policy, query, DocumentStatus::ACTUAL);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, const std::vector<bool>& removed_slots, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	return FindAllDocuments(GetMarkedQuery(query, removed_slots), StatusSet().set(), document_predicate, max_result_count);
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopQueryDocuments(ExecutionPolicy&& policy, const Query& query, const DocumentFilter& filter, size_t max_result_count) const
+{
+	std::vector<uint32_t>& slots = QueryScratch::ForCurrentThread().filtered_slots;
+	slots.clear();
+	if (FindFilteredSlots(query, filter, slots))
 	{
-		if (word_to_document_freqs_.count(word) == 0)
+		return FindFilteredDocuments(query, slots, max_result_count);
+	}
+	return FindAllDocuments(policy, query, filter.statuses, filter, max_result_count); // Most documents pass, so the postings are read as usual
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopQueryDocuments(ExecutionPolicy&& policy, const Query& query, DocumentStatus status, size_t max_result_count) const
+{
+	// Only the partitions of the status are read, so documents of other statuses cost nothing
+	return FindAllDocuments(policy, query, StatusSet().set(static_cast<size_t>(status)), [](int, DocumentStatus, int)
 		{
-			continue;
-		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+			return true;
+		}, max_result_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	//LOG_DURATION_STREAM("Operation time: ", std::cout);
+	// Documents with minus words are known before scoring, so they are never scored or accumulated
+	const std::vector<bool>& excluded_slots = FindExcludedSlots(query, statuses);
+	ScoreAccumulator& slot_to_relevance = ScoreAccumulator::ForCurrentThread();
+	slot_to_relevance.Reset(slot_document_ids_.size());
+	for (size_t term_index = 0; term_index < query.plus_terms.size(); ++term_index)
+	{
+		const TermId term_id = query.plus_terms[term_index];
+		const double inverse_document_freq = query.plus_inverse_document_freqs[term_index];
+		for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status)
 		{
-			const auto& document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status, document_data.rating))
+			if (!statuses.test(status))
 			{
-				document_to_relevance[document_id] += term_freq * inverse_document_freq;
+				continue;
 			}
+			word_to_document_freqs_[term_id][status].ForEach([this, &query, &slot_to_relevance, &excluded_slots, &document_predicate, inverse_document_freq](int slot, uint32_t term_count)
+				{
+					if (!IsExcluded(query, excluded_slots, slot) && document_predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot]))
+					{
+						slot_to_relevance.Add(slot, term_count * slot_inv_word_counts_[slot] * inverse_document_freq);
+					}
+				});
 		}
 	}
 
-	for (const std::string_view word : query.minus_words)
-	{
-		if (word_to_document_freqs_.count(word) == 0)
+	TopDocuments& top_documents = QueryScratch::ForCurrentThread().top_documents;
+	top_documents.Reset(max_result_count);
+	slot_to_relevance.ForEach([this, &top_documents](uint32_t slot, double relevance)
 		{
-			continue;
-		}
-		for (const auto [document_id, term_frequency] : word_to_document_freqs_.at(word))
-		{
-			document_to_relevance.erase(document_id);
-		}
-	}
-
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : document_to_relevance)
-	{
-		matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
-	}
-	return matched_documents;
+			top_documents.Add({ slot_document_ids_[slot], relevance, slot_ratings_[slot] });
+		});
+	return top_documents.Extract();
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy, const Query& query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const
 {
-	return FindAllDocuments(query, document_predicate);
+	return FindAllDocuments(query, statuses, document_predicate, max_result_count);
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy, const Query& scratch_query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const
 {
-	ConcurrentMap<int, double> document_to_relevance(100);
-
-	std::for_each(std::execution::par, query.minus_words.begin(), query.minus_words.end(),
-		[this, &document_to_relevance](const std::string_view word)
+	// The slots are split into ranges scored independently: every worker walks the postings of all words inside its range
+	// into its own accumulator and its own top, so nothing is shared on the hot path and even a one-word query is split.
+	// A slot belongs to one range only, so its relevance is summed word by word as in the sequential version.
+	// The exclusion bitmap is complete before the workers start and is only read by them. The query and the bitmap are copied
+	// out of the scratch of this thread, which a query it runs while waiting for the workers would reuse
+	const Query query = scratch_query;
+	const std::vector<bool> excluded_slots = FindExcludedSlots(query, statuses);
+	const size_t slot_count = slot_document_ids_.size();
+	const size_t range_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency() * ranges_per_thread_, slot_count / min_slots_per_range_));
+	std::vector<size_t> range_indexes(range_count);
+	std::iota(range_indexes.begin(), range_indexes.end(), 0);
+
+	std::vector<TopDocuments> range_tops(range_count, TopDocuments(max_result_count));
+	std::transform(std::execution::par, range_indexes.begin(), range_indexes.end(), range_tops.begin(),
+		[this, &query, &statuses, &excluded_slots, &document_predicate, slot_count, range_count, max_result_count](size_t range_index)
 		{
-			if (word_to_document_freqs_.count(word))
+			const int range_begin = static_cast<int>(slot_count * range_index / range_count);
+			const int range_end = static_cast<int>(slot_count * (range_index + 1) / range_count);
+			ScoreAccumulator& slot_to_relevance = ScoreAccumulator::ForCurrentThread();
+			slot_to_relevance.Reset(slot_count);
+			for (size_t term_index = 0; term_index < query.plus_terms.size(); ++term_index)
 			{
-				for (const auto [document_id, term_frequency] : word_to_document_freqs_.at(word))
+				const TermId term_id = query.plus_terms[term_index];
+				const double inverse_document_freq = query.plus_inverse_document_freqs[term_index];
+				for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status)
 				{
-					document_to_relevance.Erase(document_id);
+					if (!statuses.test(status) || word_to_document_freqs_[term_id][status].Empty())
+					{
+						continue;
+					}
+					PostingList::Cursor cursor(word_to_document_freqs_[term_id][status]);
+					for (cursor.NextGeq(range_begin); cursor.GetDocumentId() < range_end; cursor.Next())
+					{
+						const uint32_t slot = static_cast<uint32_t>(cursor.GetDocumentId());
+						if (!IsExcluded(query, excluded_slots, slot) && document_predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot]))
+						{
+							slot_to_relevance.Add(slot, cursor.GetTermCount() * slot_inv_word_counts_[slot] * inverse_document_freq);
+						}
+					}
 				}
 			}
+
+			TopDocuments top_documents(max_result_count);
+			slot_to_relevance.ForEach([this, &top_documents](uint32_t slot, double relevance)
+				{
+					top_documents.Add({ slot_document_ids_[slot], relevance, slot_ratings_[slot] });
+				});
+			return top_documents;
 		});
 
-	std::for_each(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
-		[this, &document_to_relevance, &document_predicate](const std::string_view word)
+	TopDocuments top_documents(max_result_count);
+	for (const TopDocuments& range_top : range_tops)
+	{
+		top_documents.Merge(range_top);
+	}
+	return top_documents.Extract();
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const BlockMaxWandPolicy, const Query& query, const StatusSet& statuses, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	QueryScratch& scratch = QueryScratch::ForCurrentThread();
+	TopDocuments& top_documents = scratch.top_documents;
+	top_documents.Reset(max_result_count);
+	if (max_result_count == 0)
+	{
+		return top_documents.Extract();
+	}
+
+	// A cursor per read partition of every term. A document has one status, so it is under one cursor of a term at most,
+	// and the cursors go in the order of the query words
+	std::vector<PostingList::Cursor>& cursors = scratch.cursors;
+	std::vector<double>& inverse_document_freqs = scratch.cursor_inverse_document_freqs;
+	std::vector<double>& max_relevances = scratch.cursor_max_relevances; // Upper bound of what a term adds to relevance of any document
+	cursors.clear();
+	inverse_document_freqs.clear();
+	max_relevances.clear();
+	for (size_t term_index = 0; term_index < query.plus_terms.size(); ++term_index)
+	{
+		const TermId term_id = query.plus_terms[term_index];
+		const double inverse_document_freq = query.plus_inverse_document_freqs[term_index];
+		for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status)
 		{
-			if (word_to_document_freqs_.count(word))
+			const PostingList& postings = word_to_document_freqs_[term_id][status];
+			if (statuses.test(status) && !postings.Empty())
 			{
-				const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-				for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
-				{
-					const auto& document_data = documents_.at(document_id);
-					if (document_predicate(document_id, document_data.status, document_data.rating))
-					{
-						document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-					}
-				}
+				cursors.emplace_back(postings);
+				inverse_document_freqs.push_back(inverse_document_freq);
+				max_relevances.push_back(postings.GetMaxTermFreq() * inverse_document_freq);
 			}
-		});
+		}
+	}
+	const size_t cursor_count = cursors.size();
 
-	std::map<int, double> document_to_relevance_accumulated = document_to_relevance.BuildOrdinaryMap();
-	std::vector<Document> matched_documents;
-	matched_documents.reserve(document_to_relevance_accumulated.size());
-	for (const auto [document_id, relevance] : document_to_relevance_accumulated)
+	const std::vector<bool>& excluded_slots = FindExcludedSlots(query, statuses);
+
+	// A document of a lower EPSILON step than the least relevant kept one never gets into a full top.
+	// The threshold is a step lower still, so rounding of the bounds never prunes a document that could get in
+	double threshold = -std::numeric_limits<double>::infinity();
+	std::vector<size_t>& order = scratch.cursor_order; // Cursors sorted by their current slot
+	order.resize(cursor_count);
+	std::iota(order.begin(), order.end(), 0);
+	while (true)
 	{
-		matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+		// Only a few cursors move per step, so the order stays almost sorted and insertion sort fixes it
+		for (size_t i = 1; i < cursor_count; ++i)
+		{
+			for (size_t j = i; j > 0 && cursors[order[j]].GetDocumentId() < cursors[order[j - 1]].GetDocumentId(); --j)
+			{
+				std::swap(order[j], order[j - 1]);
+			}
+		}
+
+		// Slots before the pivot occur only in the terms whose bounds do not sum up above the threshold
+		size_t pivot = 0;
+		double bound = 0.0;
+		for (; pivot < cursor_count && !cursors[order[pivot]].IsEnd(); ++pivot)
+		{
+			bound += max_relevances[order[pivot]];
+			if (bound > threshold)
+			{
+				break;
+			}
+		}
+		if (pivot == cursor_count || cursors[order[pivot]].IsEnd())
+		{
+			break;
+		}
+		const int pivot_slot = cursors[order[pivot]].GetDocumentId();
+		for (; pivot + 1 < cursor_count && cursors[order[pivot + 1]].GetDocumentId() == pivot_slot; ++pivot)
+		{
+		}
+
+		// The same check with the bounds of the blocks, then the cursors skip to the end of the shortest block at once
+		double block_bound = 0.0;
+		int region_end = PostingList::Cursor::end_document_id;
+		for (size_t i = 0; i <= pivot; ++i)
+		{
+			int block_end;
+			block_bound += cursors[order[i]].GetBlockMaxTermFreq(pivot_slot, block_end) * inverse_document_freqs[order[i]];
+			region_end = std::min(region_end, block_end);
+		}
+		if (block_bound <= threshold)
+		{
+			int next_slot = region_end == PostingList::Cursor::end_document_id ? region_end : region_end + 1;
+			if (pivot + 1 < cursor_count)
+			{
+				next_slot = std::min(next_slot, cursors[order[pivot + 1]].GetDocumentId());
+			}
+			for (size_t i = 0; i <= pivot; ++i)
+			{
+				cursors[order[i]].NextGeq(next_slot);
+			}
+			continue;
+		}
+
+		if (cursors[order[0]].GetDocumentId() != pivot_slot)
+		{
+			for (size_t i = 0; i < pivot; ++i)
+			{
+				cursors[order[i]].NextGeq(pivot_slot);
+			}
+			continue;
+		}
+
+		const uint32_t slot = static_cast<uint32_t>(pivot_slot);
+		if (!IsExcluded(query, excluded_slots, slot) && document_predicate(slot_document_ids_[slot], slot_statuses_[slot], slot_ratings_[slot]))
+		{
+			// Summed in the order of the query words, as the term-at-a-time versions do it
+			double relevance = 0.0;
+			for (size_t cursor_index = 0; cursor_index < cursor_count; ++cursor_index)
+			{
+				if (cursors[cursor_index].GetDocumentId() == pivot_slot)
+				{
+					relevance += cursors[cursor_index].GetTermCount() * slot_inv_word_counts_[slot] * inverse_document_freqs[cursor_index];
+				}
+			}
+			top_documents.Add({ slot_document_ids_[slot], relevance, slot_ratings_[slot] });
+			if (top_documents.IsFull())
+			{
+				threshold = (GetRelevanceStep(top_documents.GetMinRelevance()) - 1) * EPSILON;
+			}
+		}
+		for (size_t i = 0; i <= pivot; ++i)
+		{
+			cursors[order[i]].Next();
+		}
 	}
-	return matched_documents;
+	return top_documents.Extract();
 }
 
+// A query parsed and resolved against the index once, to be run many times by FindTopDocuments and MatchDocument.
+// Its words are kept, so it stays valid when documents are added or removed: term IDs and IDFs are then looked up again on each run
+class SearchServer::PreparedQuery
+{
+public:
+	const std::vector<std::string>& GetPlusWords() const; // Sorted, without repeats and stop words
+	const std::vector<std::string>& GetMinusWords() const;
+
+	// IDFs are computed from statistics rather than by the server running the query. Throws if there is not one count per plus word
+	// or a count is not between 1 and the document count
+	void SetStatistics(const QueryStatistics& statistics);
+
+private:
+	friend class SearchServer;
+
+	const SearchServer* server_ = nullptr; // A query prepared by another server is looked up again too
+	uint64_t index_epoch_ = 0;
+	std::vector<std::string> plus_words_;
+	std::vector<std::string> minus_words_;
+	std::vector<double> plus_inverse_document_freqs_; // IDFs of plus_words_ set from statistics, empty if there are none
+	Query query_;
+};
+
 void AddDocument(SearchServer& search_server, int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "segmented_search_server.h"
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words_text, size_t max_mutable_document_count)
+	: stop_words_text_(stop_words_text),
+	max_mutable_document_count_(std::max<size_t>(max_mutable_document_count, 1)),
+	mutable_segment_(std::make_shared<SearchServer>(stop_words_text)),
+	merger_([this] { MergeSegments(); })
+{
+}
+
+SegmentedSearchServer::~SegmentedSearchServer()
+{
+	{
+		std::unique_lock lock(mutex_);
+		is_stopping_ = true;
+	}
+	merge_condition_.notify_all();
+	merger_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+	std::unique_lock lock(mutex_);
+	for (const Segment& segment : segments_)
+	{
+		if (segment.search_server->HasDocument(document_id) && segment.removed_document_ids.count(document_id) == 0)
+		{
+			throw std::invalid_argument("Wrong document ID"s);
+		}
+	}
+	mutable_segment_->AddDocument(document_id, document, status, ratings);
+	if (static_cast<size_t>(mutable_segment_->GetDocumentCount()) < max_mutable_document_count_)
+	{
+		return;
+	}
+	mutable_segment_->ShrinkToFit();
+	segments_.push_back({ std::move(mutable_segment_), {}, {}, nullptr });
+	mutable_segment_ = std::make_shared<SearchServer>(std::string_view(stop_words_text_));
+	lock.unlock();
+	merge_condition_.notify_all();
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id)
+{
+	std::unique_lock lock(mutex_);
+	if (mutable_segment_->HasDocument(document_id))
+	{
+		mutable_segment_->RemoveDocument(document_id);
+		return;
+	}
+	for (Segment& segment : segments_)
+	{
+		if (segment.search_server->HasDocument(document_id) && segment.removed_document_ids.count(document_id) == 0)
+		{
+			AddRemovedDocument(segment, document_id);
+			MarkRemovedSlots(segment);
+			lock.unlock();
+			merge_condition_.notify_all(); // The segment may have to be rewritten
+			return;
+		}
+	}
+	throw std::invalid_argument("Invalid ID for deleting"s);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count) const
+{
+	// Every segment reads only the postings of the status
+	return FindSegmentDocuments(raw_query, max_result_count,
+		[status, max_result_count](const SearchServer& search_server, const SearchServer::PreparedQuery& query, const std::vector<bool>* removed_slots)
+		{
+			if (!removed_slots)
+			{
+				return search_server.FindTopDocuments(query, status, max_result_count);
+			}
+			return search_server.FindTopDocuments(query, *removed_slots, status, max_result_count);
+		});
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query) const
+{
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const
+{
+	std::shared_lock lock(mutex_);
+	int document_count = mutable_segment_->GetDocumentCount();
+	for (const Segment& segment : segments_)
+	{
+		document_count += GetLiveDocumentCount(segment);
+	}
+	return document_count;
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const
+{
+	std::shared_lock lock(mutex_);
+	return segments_.size();
+}
+
+void SegmentedSearchServer::WaitForMerges()
+{
+	std::unique_lock lock(mutex_);
+	size_t first = 0;
+	size_t last = 0;
+	merge_condition_.wait(lock, [this, &first, &last]
+		{
+			return merge_exception_ || (!is_merging_ && !FindMerge(first, last));
+		});
+	if (merge_exception_)
+	{
+		std::rethrow_exception(merge_exception_);
+	}
+}
+
+int SegmentedSearchServer::GetLiveDocumentCount(const Segment& segment)
+{
+	return segment.search_server->GetDocumentCount() - static_cast<int>(segment.removed_document_ids.size());
+}
+
+void SegmentedSearchServer::AddRemovedDocument(Segment& segment, int document_id)
+{
+	segment.removed_document_ids.insert(document_id);
+	for (const auto& [word, term_freq] : segment.search_server->GetWordFrequencies(document_id))
+	{
+		++segment.removed_word_counts[word];
+	}
+}
+
+void SegmentedSearchServer::MarkRemovedSlots(Segment& segment)
+{
+	if (segment.removed_document_ids.empty())
+	{
+		segment.removed_slots.reset();
+		return;
+	}
+	segment.removed_slots = std::make_shared<const std::vector<bool>>(segment.search_server->MarkDocumentSlots(segment.removed_document_ids));
+}
+
+bool SegmentedSearchServer::FindMerge(size_t& first, size_t& last) const
+{
+	// Sizes fall from the oldest segment like the digits of a binary counter, two segments of one size make one of the next
+	const size_t segment_count = segments_.size();
+	if (segment_count >= 2 && GetLiveDocumentCount(segments_[segment_count - 1]) * 2 >= GetLiveDocumentCount(segments_[segment_count - 2]))
+	{
+		first = segment_count - 2;
+		last = segment_count - 1;
+		return true;
+	}
+	// A segment that is mostly removed documents is rewritten alone
+	for (size_t i = 0; i < segment_count; ++i)
+	{
+		if (segments_[i].removed_document_ids.size() * 2 > static_cast<size_t>(segments_[i].search_server->GetDocumentCount()))
+		{
+			first = i;
+			last = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SegmentedSearchServer::MergeSegments()
+{
+	std::unique_lock lock(mutex_);
+	while (true)
+	{
+		size_t first = 0;
+		size_t last = 0;
+		merge_condition_.wait(lock, [this, &first, &last]
+			{
+				return is_stopping_ || (!merge_exception_ && FindMerge(first, last));
+			});
+		if (is_stopping_)
+		{
+			return;
+		}
+		// Frozen segments do not change, so they are merged without the lock and only the removals made meanwhile are carried over
+		const std::vector<Segment> merged_segments(segments_.begin() + first, segments_.begin() + last + 1);
+		is_merging_ = true;
+		lock.unlock();
+
+		std::shared_ptr<SearchServer> search_server;
+		try
+		{
+			search_server = std::make_shared<SearchServer>(std::string_view(stop_words_text_));
+			for (const Segment& segment : merged_segments)
+			{
+				search_server->MergeDocuments(*segment.search_server, segment.removed_document_ids);
+			}
+			search_server->ShrinkToFit();
+		}
+		catch (...)
+		{
+			// The segments stay as they are and are searched as before, the error goes to WaitForMerges
+			lock.lock();
+			merge_exception_ = std::current_exception();
+			is_merging_ = false;
+			merge_condition_.notify_all();
+			continue;
+		}
+
+		lock.lock();
+		// Only this thread takes segments out, so the merged ones are still where they were
+		Segment merged{ std::move(search_server), {}, {}, nullptr };
+		for (size_t i = first; i <= last; ++i)
+		{
+			const std::set<int>& removed_before = merged_segments[i - first].removed_document_ids;
+			std::vector<int> removed_meanwhile;
+			std::set_difference(segments_[i].removed_document_ids.begin(), segments_[i].removed_document_ids.end(),
+				removed_before.begin(), removed_before.end(), std::back_inserter(removed_meanwhile));
+			for (const int document_id : removed_meanwhile)
+			{
+				AddRemovedDocument(merged, document_id);
+			}
+		}
+		segments_.erase(segments_.begin() + first + 1, segments_.begin() + last + 1);
+		if (merged.search_server->GetDocumentCount() > 0)
+		{
+			MarkRemovedSlots(merged);
+			segments_[first] = std::move(merged);
+		}
+		else
+		{
+			segments_.erase(segments_.begin() + first); // Nothing to search in, so nothing could have been removed meanwhile
+		}
+		is_merging_ = false;
+		merge_condition_.notify_all();
+	}
+}
\ No newline at end of file
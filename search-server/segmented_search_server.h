@@ -0,0 +1,140 @@
+#pragma once
+#include "search_server.h"
+#include "document.h"
+#include "top_documents.h"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// An index split into immutable segments and a small mutable one, as in a log-structured merge tree.
+// New documents go to the mutable segment, which is frozen once it holds max_mutable_document_count documents.
+// A background thread merges the newest segments while the last one is at least half the size of the one before it,
+// so there are about log(N) segments and every document is rewritten about log(N) times.
+// A document removed from a frozen segment is only marked, it leaves the index with the next merge of its segment.
+// Segments are searched with IDFs of the whole corpus, so results are those of one SearchServer with the same documents.
+// A query holds the lock only to get the statistics, search the mutable segment and take the frozen ones with their marks.
+// All methods may be called from any threads
+class SegmentedSearchServer
+{
+public:
+	explicit SegmentedSearchServer(std::string_view stop_words_text, size_t max_mutable_document_count = default_max_mutable_document_count_);
+	~SegmentedSearchServer(); // Stops the merging thread, a merge in progress is finished first
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	int GetDocumentCount() const;
+	size_t GetSegmentCount() const; // Frozen segments, the mutable one is not counted
+	// Blocks until no merge is running or due. Rethrows the exception of a failed merge, which keeps its segments and stops merging
+	void WaitForMerges();
+
+private:
+	struct Segment
+	{
+		std::shared_ptr<const SearchServer> search_server; // Never changed once frozen, a merge builds a new one
+		std::set<int> removed_document_ids; // Still in search_server until the segment is merged
+		std::unordered_map<std::string_view, int> removed_word_counts; // Removed documents with each word, the words are those of search_server
+		// The same documents marked by slot for the searches. Replaced rather than changed, so a search may go on with the old marks
+		std::shared_ptr<const std::vector<bool>> removed_slots;
+	};
+
+	static constexpr size_t default_max_mutable_document_count_ = 10'000;
+
+	const std::string stop_words_text_;
+	const size_t max_mutable_document_count_;
+	mutable std::shared_mutex mutex_; // Searches share it, changes and commits of merges take it exclusively
+	std::shared_ptr<SearchServer> mutable_segment_; // Frozen by moving it to segments_
+	std::vector<Segment> segments_; // From the oldest one, which is the largest
+	bool is_merging_ = false;
+	bool is_stopping_ = false;
+	std::exception_ptr merge_exception_; // Of the merge that failed, no merge runs after it
+	std::condition_variable_any merge_condition_; // Signalled when a merge may be due or is over
+	std::thread merger_; // Started last, as it uses all the members above
+
+	static int GetLiveDocumentCount(const Segment& segment);
+	static void AddRemovedDocument(Segment& segment, int document_id); // Marks a document of search_server removed and counts its words
+	static void MarkRemovedSlots(Segment& segment); // Builds removed_slots from removed_document_ids
+	bool FindMerge(size_t& first, size_t& last) const; // Picks the segments to merge, mutex_ must be held
+	void MergeSegments(); // The body of merger_
+
+	// Calls search(search_server, query, removed_slots) for every segment and keeps the best documents.
+	// removed_slots is nullptr for a segment without removed documents
+	template <typename Search>
+	std::vector<Document> FindSegmentDocuments(std::string_view raw_query, size_t max_result_count, Search search) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	return FindSegmentDocuments(raw_query, max_result_count,
+		[&document_predicate, max_result_count](const SearchServer& search_server, const SearchServer::PreparedQuery& query, const std::vector<bool>* removed_slots)
+		{
+			if (!removed_slots)
+			{
+				return search_server.FindTopDocuments(query, document_predicate, max_result_count);
+			}
+			return search_server.FindTopDocuments(query, *removed_slots, document_predicate, max_result_count);
+		});
+}
+
+template <typename Search>
+std::vector<Document> SegmentedSearchServer::FindSegmentDocuments(std::string_view raw_query, size_t max_result_count, Search search) const
+{
+	TopDocuments top_documents(max_result_count);
+	std::vector<std::pair<std::shared_ptr<const SearchServer>, std::shared_ptr<const std::vector<bool>>>> frozen_segments;
+	std::shared_lock lock(mutex_);
+	frozen_segments.reserve(segments_.size());
+	SearchServer::PreparedQuery query = mutable_segment_->PrepareQuery(raw_query);
+	SearchServer::QueryStatistics statistics = mutable_segment_->GetQueryStatistics(query);
+	const std::vector<std::string>& plus_words = query.GetPlusWords();
+	for (const Segment& segment : segments_)
+	{
+		// Removed documents are taken off by their word counts, so a query costs the same however many there are
+		const SearchServer::QueryStatistics segment_statistics = segment.search_server->GetQueryStatistics(query);
+		statistics.document_count += segment_statistics.document_count - static_cast<int>(segment.removed_document_ids.size());
+		for (size_t i = 0; i < plus_words.size(); ++i)
+		{
+			const auto it = segment.removed_word_counts.find(plus_words[i]);
+			statistics.plus_word_document_counts[i] += segment_statistics.plus_word_document_counts[i] - (it == segment.removed_word_counts.end() ? 0 : it->second);
+		}
+		frozen_segments.emplace_back(segment.search_server, segment.removed_slots);
+	}
+	// Words no live document has match nothing, so any valid count does for them. Without documents IDFs are not needed
+	for (int& document_freq : statistics.plus_word_document_counts)
+	{
+		document_freq = std::max(document_freq, 1);
+	}
+	if (statistics.document_count > 0)
+	{
+		query.SetStatistics(statistics);
+	}
+	for (const Document& document : search(*mutable_segment_, query, nullptr))
+	{
+		top_documents.Add(document);
+	}
+	lock.unlock();
+
+	// Frozen segments and their marks never change, the ones taken are searched as they were when the statistics were counted
+	for (const auto& [search_server, removed_slots] : frozen_segments)
+	{
+		for (const Document& document : search(*search_server, query, removed_slots.get()))
+		{
+			top_documents.Add(document);
+		}
+	}
+	return top_documents.Extract();
+}
\ No newline at end of file
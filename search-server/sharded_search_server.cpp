@@ -0,0 +1,104 @@
+#include "sharded_search_server.h"
+#include <functional>
+#include <mutex>
+
+ShardedSearchServer::Shard::Shard(std::string_view stop_words_text)
+	: search_server(stop_words_text)
+{
+}
+
+ShardedSearchServer::ShardedSearchServer(std::string_view stop_words_text, size_t shard_count)
+{
+	shard_count = std::max<size_t>(shard_count, 1);
+	for (size_t i = 0; i < shard_count; ++i)
+	{
+		shards_.push_back(std::make_unique<Shard>(stop_words_text));
+	}
+}
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+	Shard& shard = GetShard(document_id);
+	std::unique_lock lock(shard.mutex);
+	shard.search_server.AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+	Shard& shard = GetShard(document_id);
+	std::unique_lock lock(shard.mutex);
+	shard.search_server.RemoveDocument(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count) const
+{
+	// Every shard reads only the postings of the status
+	return FindShardDocuments(std::execution::par, raw_query, max_result_count, [status, max_result_count](const SearchServer& search_server, const SearchServer::PreparedQuery& query)
+		{
+			return search_server.FindTopDocuments(query, status, max_result_count);
+		});
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query) const
+{
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+	int document_count = 0;
+	for (const std::unique_ptr<Shard>& shard : shards_)
+	{
+		std::shared_lock lock(shard->mutex);
+		document_count += shard->search_server.GetDocumentCount();
+	}
+	return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+	return shards_.size();
+}
+
+int ShardedSearchServer::GetShardDocumentCount(size_t shard_index) const
+{
+	const Shard& shard = *shards_.at(shard_index);
+	std::shared_lock lock(shard.mutex);
+	return shard.search_server.GetDocumentCount();
+}
+
+ShardedSearchServer::Shard& ShardedSearchServer::GetShard(int document_id) const
+{
+	return *shards_[std::hash<int>{}(document_id) % shards_.size()];
+}
+
+SearchServer::PreparedQuery ShardedSearchServer::PrepareQuery(std::string_view raw_query) const
+{
+	SearchServer::PreparedQuery query;
+	SearchServer::QueryStatistics statistics;
+	{
+		std::shared_lock lock(shards_.front()->mutex);
+		query = shards_.front()->search_server.PrepareQuery(raw_query);
+		statistics = shards_.front()->search_server.GetQueryStatistics(query);
+	}
+	for (size_t i = 1; i < shards_.size(); ++i)
+	{
+		std::shared_lock lock(shards_[i]->mutex);
+		const SearchServer::QueryStatistics shard_statistics = shards_[i]->search_server.GetQueryStatistics(query);
+		statistics.document_count += shard_statistics.document_count;
+		for (size_t j = 0; j < statistics.plus_word_document_counts.size(); ++j)
+		{
+			statistics.plus_word_document_counts[j] += shard_statistics.plus_word_document_counts[j];
+		}
+	}
+	// Words missing from every shard match nothing and get a count of 1 only to be valid, empty shards search nothing
+	for (int& document_freq : statistics.plus_word_document_counts)
+	{
+		document_freq = std::max(document_freq, 1);
+	}
+	if (statistics.document_count > 0)
+	{
+		query.SetStatistics(statistics);
+	}
+	return query;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include "search_server.h"
+#include "document.h"
+#include "top_documents.h"
+#include <algorithm>
+#include <execution>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Documents partitioned over SearchServer shards by a hash of their IDs. A change locks only the shard of its document,
+// so writers of different shards run at once. A query adds up the document counts of the shards to get the IDFs of the whole
+// corpus, then searches the shards in parallel and merges their top documents. Every shard is locked only while its counts are read
+// and while it is searched, so a write waits for the queries of its own shard only. Without concurrent writes results are those
+// of one SearchServer with the same documents, a write between the two steps may leave the IDFs of a query slightly stale.
+// All methods may be called from any threads
+class ShardedSearchServer
+{
+public:
+	explicit ShardedSearchServer(std::string_view stop_words_text, size_t shard_count = std::max(1u, std::thread::hardware_concurrency()));
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+
+	// The policy is the one of the fan-out, each shard is searched in one thread. The predicate may be called from several threads at once
+	template <typename DocumentPredicate, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	// Without a policy the shards are searched in parallel
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	int GetDocumentCount() const;
+	size_t GetShardCount() const;
+	int GetShardDocumentCount(size_t shard_index) const;
+
+private:
+	struct Shard
+	{
+		mutable std::shared_mutex mutex; // Queries share it, changes of the shard take it exclusively
+		SearchServer search_server;
+
+		explicit Shard(std::string_view stop_words_text);
+	};
+
+	std::vector<std::unique_ptr<Shard>> shards_;
+
+	Shard& GetShard(int document_id) const;
+	// Parses the query and gives it the document counts of all shards, locking one shard at a time
+	SearchServer::PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+	// Calls search(search_server, query) for every shard under its lock and keeps the best documents
+	template <typename ExecutionPolicy, typename Search>
+	std::vector<Document> FindShardDocuments(ExecutionPolicy&& policy, std::string_view raw_query, size_t max_result_count, Search search) const;
+};
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	return FindShardDocuments(policy, raw_query, max_result_count, [&document_predicate, max_result_count](const SearchServer& search_server, const SearchServer::PreparedQuery& query)
+		{
+			return search_server.FindTopDocuments(query, document_predicate, max_result_count);
+		});
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_count) const
+{
+	return FindTopDocuments(std::execution::par, raw_query, document_predicate, max_result_count);
+}
+
+template <typename ExecutionPolicy, typename Search>
+std::vector<Document> ShardedSearchServer::FindShardDocuments(ExecutionPolicy&& policy, std::string_view raw_query, size_t max_result_count, Search search) const
+{
+	const SearchServer::PreparedQuery query = PrepareQuery(raw_query);
+	std::vector<std::vector<Document>> shard_documents(shards_.size());
+	std::transform(policy, shards_.begin(), shards_.end(), shard_documents.begin(), [&query, &search](const std::unique_ptr<Shard>& shard)
+		{
+			std::shared_lock lock(shard->mutex);
+			return search(shard->search_server, query);
+		});
+	TopDocuments top_documents(max_result_count);
+	for (const std::vector<Document>& documents : shard_documents)
+	{
+		for (const Document& document : documents)
+		{
+			top_documents.Add(document);
+		}
+	}
+	return top_documents.Extract();
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include "search_server.h"
+#include "snapshot_search_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel_search_benchmark.h"
+
+using namespace std;
+
+// Readers run the queries in a loop until stop is set, every query is timed
+vector<double> ReadSnapshotSearch(const SnapshotSearchServer& search_server, const vector<string>& queries, int reader_count, const atomic<bool>& stop)
+{
+	vector<vector<double>> reader_latencies(reader_count);
+	vector<thread> readers;
+	for (int reader_index = 0; reader_index < reader_count; ++reader_index)
+	{
+		readers.emplace_back([&search_server, &queries, &stop, &latencies = reader_latencies[reader_index], reader_index]
+			{
+				for (size_t i = reader_index; !stop; i = (i + 1) % queries.size())
+				{
+					const auto start = chrono::steady_clock::now();
+					search_server.FindTopDocuments(queries[i]);
+					latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+				}
+			});
+	}
+	for (thread& reader : readers)
+	{
+		reader.join();
+	}
+	vector<double> latencies;
+	for (const vector<double>& reader_latency : reader_latencies)
+	{
+		latencies.insert(latencies.end(), reader_latency.begin(), reader_latency.end());
+	}
+	sort(latencies.begin(), latencies.end());
+	return latencies;
+}
+
+void PrintLatenciesSnapshotSearch(string_view mark, const vector<double>& latencies)
+{
+	cout << mark << ": "s << latencies.size() << " queries, p50 "s << latencies[latencies.size() / 2] << " ms, p99 "s
+		<< latencies[latencies.size() * 99 / 100] << " ms, max "s << latencies.back() << " ms"s << endl;
+}
+
+// Reader latency with and without a writer adding and removing documents in batches and publishing every batch
+void SnapshotSearchBenchmark()
+{
+	mt19937 generator;
+	const auto dictionary = GenerateDictionaryParallelSearch(generator, 2'000, 25);
+	const auto documents = GenerateQueriesParallelSearch(generator, dictionary, 30'000, 10);
+	const auto queries = GenerateQueriesParallelSearch(generator, dictionary, 2'000, 7);
+	SearchServer initial_server(dictionary[0]);
+	for (int id = 0; id < 20'000; ++id)
+	{
+		initial_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1, 2, 3 });
+	}
+	SnapshotSearchServer search_server(initial_server);
+	const int reader_count = max(2, static_cast<int>(thread::hardware_concurrency()) - 1);
+
+	atomic<bool> stop = false;
+	thread timer([&stop]
+		{
+			this_thread::sleep_for(chrono::milliseconds(300));
+			stop = true;
+		});
+	PrintLatenciesSnapshotSearch("Snapshot reads without writes"s, ReadSnapshotSearch(search_server, queries, reader_count, stop));
+	timer.join();
+
+	stop = false;
+	thread writer([&search_server, &documents, &stop]
+		{
+			LOG_DURATION("Snapshot writes"s);
+			for (int id = 20'000; id < 30'000; id += 100)
+			{
+				for (int i = id; i < id + 100; ++i)
+				{
+					search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+					search_server.RemoveDocument(i - 20'000);
+				}
+				search_server.Publish();
+			}
+			stop = true;
+		});
+	PrintLatenciesSnapshotSearch("Snapshot reads during writes"s, ReadSnapshotSearch(search_server, queries, reader_count, stop));
+	writer.join();
+}
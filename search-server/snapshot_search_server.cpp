@@ -0,0 +1,69 @@
+#include "snapshot_search_server.h"
+#include <thread>
+
+SnapshotSearchServer::SnapshotSearchServer(const SearchServer& search_server)
+	: front_(std::make_shared<SearchServer>(search_server)),
+	back_(std::make_shared<SearchServer>(search_server))
+{
+	PublishFront();
+}
+
+std::shared_ptr<const SearchServer> SnapshotSearchServer::GetSnapshot() const
+{
+	return std::atomic_load(&published_);
+}
+
+void SnapshotSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings)
+{
+	ApplyChange([document_id, document = std::string(document), status, ratings](SearchServer& search_server)
+		{
+			search_server.AddDocument(document_id, document, status, ratings);
+		});
+}
+
+void SnapshotSearchServer::AddDocuments(const std::vector<DocumentRecord>& documents)
+{
+	AddDocuments(std::execution::seq, documents);
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id)
+{
+	ApplyChange([document_id](SearchServer& search_server)
+		{
+			search_server.RemoveDocument(document_id);
+		});
+}
+
+void SnapshotSearchServer::Publish()
+{
+	if (changes_.empty())
+	{
+		return;
+	}
+	std::swap(front_, back_);
+	std::shared_ptr<std::atomic<bool>> back_released = front_released_;
+	PublishFront();
+
+	// Readers get the new copy from now on, the old one may be changed once the readers that loaded it before are gone
+	while (!back_released->load(std::memory_order_acquire))
+	{
+		std::this_thread::yield();
+	}
+	for (const auto& change : changes_)
+	{
+		change(*back_);
+	}
+	changes_.clear();
+}
+
+void SnapshotSearchServer::PublishFront()
+{
+	// The snapshots share a control block of their own, whose deleter runs after the last of them is released.
+	// It keeps the copy alive, so snapshots may outlive this object
+	front_released_ = std::make_shared<std::atomic<bool>>(false);
+	std::shared_ptr<const SearchServer> snapshot(front_.get(), [search_server = front_, released = front_released_](const SearchServer*)
+		{
+			released->store(true, std::memory_order_release);
+		});
+	std::atomic_store(&published_, std::move(snapshot));
+}
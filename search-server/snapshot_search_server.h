@@ -0,0 +1,82 @@
+#pragma once
+#include "search_server.h"
+#include "document.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Lets queries run while documents are added and removed. Readers take an immutable snapshot of the index and never wait for the writer.
+// The writer changes a second copy of the index and publishes it by an atomic swap of the pointer, then waits for the readers
+// of the old copy to leave and replays the same changes on it, so two copies serve all versions (left-right scheme).
+// Reading methods may be called from any threads, changing ones from one thread at a time
+class SnapshotSearchServer
+{
+public:
+	explicit SnapshotSearchServer(const SearchServer& search_server);
+
+	std::shared_ptr<const SearchServer> GetSnapshot() const; // The latest published index, it does not change while it is held
+
+	template <typename... Args>
+	std::vector<Document> FindTopDocuments(Args&&... args) const; // Any search of SearchServer, run on the latest snapshot
+
+	// Changes go to the unpublished copy and become visible together on Publish.
+	// They throw as those of SearchServer do, a rejected change is not applied to any copy
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	template <typename ExecutionPolicy>
+	void AddDocuments(ExecutionPolicy&& policy, const std::vector<DocumentRecord>& documents);
+	void AddDocuments(const std::vector<DocumentRecord>& documents);
+	void RemoveDocument(int document_id);
+
+	// Makes the changes visible to the next readers, then waits until the earlier readers release their snapshots.
+	// Snapshots must not be held for long by the writer thread itself
+	void Publish();
+
+private:
+	std::shared_ptr<const SearchServer> published_; // Loaded and stored with atomic_load and atomic_store only
+	std::shared_ptr<SearchServer> front_; // The published copy
+	std::shared_ptr<SearchServer> back_; // The copy the writer changes
+	std::shared_ptr<std::atomic<bool>> front_released_; // Set once the last snapshot of front_ is released
+	std::vector<std::function<void(SearchServer&)>> changes_; // Applied to back_ since the last Publish, to be replayed on front_
+
+	void PublishFront(); // Gives readers a pointer to front_ of its own, which sets front_released_ when the readers are gone
+
+	template <typename Change>
+	void ApplyChange(Change change); // Applies to back_ and keeps the change if it does not throw
+};
+
+template <typename... Args>
+std::vector<Document> SnapshotSearchServer::FindTopDocuments(Args&&... args) const
+{
+	return GetSnapshot()->FindTopDocuments(std::forward<Args>(args)...);
+}
+
+template <typename ExecutionPolicy>
+void SnapshotSearchServer::AddDocuments(ExecutionPolicy&& policy, const std::vector<DocumentRecord>& documents)
+{
+	// Records only point to the texts, the replay needs its own copies
+	std::vector<std::string> texts;
+	texts.reserve(documents.size());
+	for (const DocumentRecord& document : documents)
+	{
+		texts.emplace_back(document.text);
+	}
+	ApplyChange([policy, documents, texts = std::move(texts)](SearchServer& search_server)
+		{
+			std::vector<DocumentRecord> records = documents;
+			for (size_t i = 0; i < records.size(); ++i)
+			{
+				records[i].text = texts[i];
+			}
+			search_server.AddDocuments(policy, records);
+		});
+}
+
+template <typename Change>
+void SnapshotSearchServer::ApplyChange(Change change)
+{
+	change(*back_);
+	changes_.push_back(std::move(change));
+}
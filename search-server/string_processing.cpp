@@ -1,4 +1,14 @@
 #include "string_processing.h"
+#include <cstdint>
+
+// SSE2 is a part of every x64 processor, so it is checked at compile time only
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STRING_PROCESSING_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
 //std::vector<std::string> SplitIntoWords(const std::string & text)
 //{
@@ -27,16 +37,86 @@
 //	return words;
 //}
 
-std::vector<std::string_view> SplitIntoWords(std::string_view str)
+#ifdef STRING_PROCESSING_SSE2
+namespace
 {
-	std::vector<std::string_view> result;
-	int64_t pos = str.find_first_not_of(" ");
-	const int64_t pos_end = str.npos;
-	while (pos != pos_end)
+	// Index of the lowest set bit, the mask must not be zero
+	inline int FindLowestBit(uint32_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+}
+#endif
+
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words)
+{
+	words.clear();
+	const char* const data = text.data();
+	const size_t size = text.size();
+	bool has_control = false;
+	bool in_word = false;
+	size_t word_begin = 0;
+	size_t pos = 0;
+#ifdef STRING_PROCESSING_SSE2
+	// 16 bytes at a time: a bit mask of spaces gives the word boundaries where it changes, control characters are ORed up on the way
+	const __m128i spaces = _mm_set1_epi8(' ');
+	const __m128i max_controls = _mm_set1_epi8(' ' - 1);
+	__m128i controls = _mm_setzero_si128();
+	for (; pos + 16 <= size; pos += 16)
 	{
-		int64_t space = str.find(' ', pos);
-		result.push_back(space == pos_end ? str.substr(pos) : str.substr(pos, space - pos));
-		pos = str.find_first_not_of(" ", space);
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		controls = _mm_or_si128(controls, _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_controls), chunk)); // Unsigned byte below the space
+		const uint32_t space_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)));
+		uint32_t boundaries = (space_mask ^ ((space_mask << 1) | (in_word ? 0u : 1u))) & 0xFFFFu; // Bytes unlike the previous ones
+		for (; boundaries != 0; boundaries &= boundaries - 1)
+		{
+			const size_t boundary = pos + FindLowestBit(boundaries);
+			if (in_word)
+			{
+				words.emplace_back(data + word_begin, boundary - word_begin);
+			}
+			else
+			{
+				word_begin = boundary;
+			}
+			in_word = !in_word;
+		}
 	}
+	has_control = _mm_movemask_epi8(controls) != 0;
+#endif
+	for (; pos < size; ++pos)
+	{
+		const unsigned char c = static_cast<unsigned char>(data[pos]);
+		has_control |= c < ' ';
+		if ((c != ' ') != in_word)
+		{
+			if (in_word)
+			{
+				words.emplace_back(data + word_begin, pos - word_begin);
+			}
+			else
+			{
+				word_begin = pos;
+			}
+			in_word = !in_word;
+		}
+	}
+	if (in_word)
+	{
+		words.emplace_back(data + word_begin, size - word_begin);
+	}
+	return !has_control;
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view str)
+{
+	std::vector<std::string_view> result;
+	SplitIntoWords(str, result);
 	return result;
 }
\ No newline at end of file
@@ -1,8 +1,12 @@
 #pragma once
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Splits text by spaces into words, overwriting words so that its capacity is reused. In the same pass checks the text for
+// control characters (bytes below the space) and returns false if there are any, the words are split all the same
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings)
@@ -0,0 +1,80 @@
+#include "term_dictionary.h"
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+	: words_(other.words_),
+	free_ids_(other.free_ids_)
+{
+	// Keys of the other dictionary point into its own strings, so they are rebuilt over the copies
+	word_to_id_.reserve(words_.size() - free_ids_.size());
+	for (TermId term_id = 0; term_id < words_.size(); ++term_id)
+	{
+		if (!words_[term_id].empty())
+		{
+			word_to_id_.emplace(words_[term_id], term_id);
+		}
+	}
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other)
+{
+	if (this != &other)
+	{
+		TermDictionary copy(other);
+		*this = std::move(copy);
+	}
+	return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view word)
+{
+	const auto it = word_to_id_.find(word);
+	if (it != word_to_id_.end())
+	{
+		return it->second;
+	}
+	if (!free_ids_.empty())
+	{
+		const TermId term_id = free_ids_.back();
+		free_ids_.pop_back();
+		words_[term_id] = word; // The key is made after the assignment, which may move the text
+		word_to_id_.emplace(words_[term_id], term_id);
+		return term_id;
+	}
+	const TermId term_id = static_cast<TermId>(words_.size());
+	const std::string& stored_word = words_.emplace_back(word);
+	word_to_id_.emplace(stored_word, term_id);
+	return term_id;
+}
+
+void TermDictionary::Release(TermId term_id)
+{
+	// The key is erased before its text, so no key ever points to freed memory
+	word_to_id_.erase(words_.at(term_id));
+	std::string().swap(words_[term_id]);
+	free_ids_.push_back(term_id);
+}
+
+std::optional<TermId> TermDictionary::Find(std::string_view word) const
+{
+	const auto it = word_to_id_.find(word);
+	if (it == word_to_id_.end())
+	{
+		return std::nullopt;
+	}
+	return it->second;
+}
+
+std::string_view TermDictionary::GetWord(TermId term_id) const
+{
+	return words_.at(term_id);
+}
+
+size_t TermDictionary::GetTermCount() const
+{
+	return words_.size();
+}
+
+size_t TermDictionary::GetWordCount() const
+{
+	return word_to_id_.size();
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <unordered_map>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+#include <string>
+#include <deque>
+#include <vector>
+
+using TermId = uint32_t;
+
+// Assigns each distinct word a dense ID and owns the text of the words, so the indexes can work on integers
+class TermDictionary
+{
+public:
+	TermDictionary() = default;
+	TermDictionary(const TermDictionary& other);
+	TermDictionary(TermDictionary&& other) = default;
+	TermDictionary& operator=(const TermDictionary& other);
+	TermDictionary& operator=(TermDictionary&& other) = default;
+
+	TermId Intern(std::string_view word); // Returns ID of the word, a new word gets a released ID or the next one
+	void Release(TermId term_id); // Forgets the word and frees its text, the ID is given to the next new word
+	std::optional<TermId> Find(std::string_view word) const;
+	std::string_view GetWord(TermId term_id) const; // Empty for a released ID
+	size_t GetTermCount() const; // Bound of the IDs, released ones included, so tables indexed by term ID have this size
+	size_t GetWordCount() const; // Words that have IDs now
+
+private:
+	std::deque<std::string> words_; // [term ID]: word text, deque never relocates the strings the keys below point to
+	std::unordered_map<std::string_view, TermId> word_to_id_;
+	std::vector<TermId> free_ids_; // Released IDs, their words are empty
+};
\ No newline at end of file
@@ -65,6 +65,22 @@ void TestAddDocument()
 		const auto found_docs = server.FindTopDocuments("dog"s);
 		ASSERT_EQUAL_HINT(found_docs.size(), 0, "This document should not exist."s);
 	}
+
+	{
+		// Repeated words are counted once per document, stop words are not counted in its length
+		SearchServer server("in the"s);
+		string long_content;
+		for (int i = 0; i < 40; ++i)
+		{
+			long_content += "word"s + to_string(i % 20) + " the "s;
+		}
+		server.AddDocument(doc_id, content + " in the "s + long_content, DocumentStatus::ACTUAL, ratings);
+		const auto word_frequencies = server.GetWordFrequencies(doc_id);
+		ASSERT_EQUAL(word_frequencies.size(), 25u);
+		ASSERT_EQUAL(word_frequencies.at("white"s), 2.0 / 46);
+		ASSERT_EQUAL(word_frequencies.at("word7"s), 2.0 / 46);
+		ASSERT_EQUAL(word_frequencies.at("cat"s), 1.0 / 46);
+	}
 }
 
 SearchServer AddFewDocsForTests()
@@ -82,6 +98,46 @@ SearchServer AddFewDocsForTests()
 	return search_server;
 }
 
+// The stop words "and" and "with", then "word0", "word1" and so on, so random texts also have stop words
+std::vector<std::string> MakeNumberedWords(int word_count)
+{
+	std::vector<std::string> words = { "and"s, "with"s };
+	for (int i = 0; i < word_count; ++i)
+	{
+		words.push_back("word"s + std::to_string(i));
+	}
+	return words;
+}
+
+// Texts of 1 to max_word_count words drawn from words with repeats
+std::vector<std::string> MakeRandomTexts(std::mt19937& generator, const std::vector<std::string>& words, size_t text_count, int max_word_count)
+{
+	std::vector<std::string> texts;
+	texts.reserve(text_count);
+	for (size_t i = 0; i < text_count; ++i)
+	{
+		std::string text;
+		const int word_count = std::uniform_int_distribution(1, max_word_count)(generator);
+		for (int j = 0; j < word_count; ++j)
+		{
+			text += words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+		}
+		texts.push_back(std::move(text));
+	}
+	return texts;
+}
+
+// The same documents in the same order, relevances may differ by max_relevance_error
+void AssertSameDocuments(const std::vector<Document>& found, const std::vector<Document>& expected, double max_relevance_error)
+{
+	ASSERT_EQUAL(found.size(), expected.size());
+	for (size_t i = 0; i < found.size(); ++i)
+	{
+		ASSERT_EQUAL(found[i].id, expected[i].id);
+		ASSERT(std::abs(found[i].relevance - expected[i].relevance) <= max_relevance_error);
+	}
+}
+
 void TestExcludeDocumentsWithMinusWordsFromSearchResults()
 {
 	SearchServer test_serv = AddFewDocsForTests();
@@ -98,6 +154,14 @@ void TestExcludeDocumentsWithMinusWordsFromSearchResults()
 
 	const Document& doc0 = found_docs[0];
 	ASSERT_EQUAL_HINT(doc0.id, 3u, "It should be only document number 3."s);
+
+	// Excluded documents must not take places of the page in any version
+	for (const auto& found : { test_serv.FindTopDocuments(std::execution::par, "well-groomed dog -dog"s, DocumentStatus::ACTUAL, 1),
+		test_serv.FindTopDocuments(BLOCK_MAX_WAND, "well-groomed dog -dog"s, DocumentStatus::ACTUAL, 1) })
+	{
+		ASSERT_EQUAL(found.size(), static_cast<size_t>(1));
+		ASSERT_EQUAL(found[0].id, 3u);
+	}
 }
 
 void TestMatchDocuments()
@@ -195,6 +259,22 @@ void TestSearchDocsByStatus()
 
 	const Document& doc0 = found_docs[0];
 	ASSERT_EQUAL(doc0.id, 1);
+
+	// Documents of every status count in IDF, so the status filter and the same predicate give equal relevance
+	const auto is_irrelevant = [](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::IRRELEVANT; };
+	for (const auto& found : { search_server.FindTopDocuments("yellow eyed cat"s, is_irrelevant), search_server.FindTopDocuments(std::execution::par, "cat"s, DocumentStatus::IRRELEVANT),
+		search_server.FindTopDocuments(BLOCK_MAX_WAND, "cat"s, DocumentStatus::IRRELEVANT) })
+	{
+		ASSERT_EQUAL(found.size(), static_cast<size_t>(1));
+		ASSERT_EQUAL(found[0].id, 1);
+		ASSERT(std::abs(found[0].relevance - doc0.relevance) < EPSILON);
+	}
+	ASSERT(search_server.FindTopDocuments("yellow eyed cat -ears"s, DocumentStatus::IRRELEVANT).empty());
+	ASSERT_EQUAL(std::get<0>(search_server.MatchDocument("fluffy cat"s, 1)).size(), static_cast<size_t>(2));
+
+	search_server.RemoveDocument(1);
+	ASSERT(search_server.FindTopDocuments("cat"s, DocumentStatus::IRRELEVANT).empty());
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).size(), static_cast<size_t>(2));
 }
 
 void TestRelevanceCalculate()
@@ -248,6 +328,1191 @@ void TestRelevanceCalculate()
 	}
 }
 
+void TestAddAndRemoveDocumentsInAnyOrder()
+{
+	SearchServer search_server("and with"s);
+	// Descending IDs never hit the end of a posting list, so every document goes through the append buffer
+	for (int id = 299; id >= 0; --id)
+	{
+		search_server.AddDocument(id, id % 3 == 0 ? "white cat"s : "black dog"s, DocumentStatus::ACTUAL, { id });
+	}
+	for (int id = 0; id < 300; id += 2)
+	{
+		search_server.RemoveDocument(id);
+	}
+	ASSERT_EQUAL(search_server.GetDocumentCount(), 150);
+
+	const auto found_docs = search_server.FindTopDocuments("cat"s);
+	ASSERT_EQUAL(found_docs.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	ASSERT_EQUAL(found_docs[0].id, 297);
+	ASSERT_EQUAL(found_docs[1].id, 291);
+
+	auto [words, status] = search_server.MatchDocument("white cat -dog"s, 3);
+	ASSERT_EQUAL(words.size(), static_cast<size_t>(2));
+	auto [no_words, no_status] = search_server.MatchDocument("white cat"s, 5);
+	ASSERT(no_words.empty());
+
+	// New documents take the slots of the removed ones, iteration stays ordered by ID
+	search_server.AddDocument(1000, "white cat"s, DocumentStatus::ACTUAL, { 1000 });
+	search_server.AddDocument(4, "grey cat"s, DocumentStatus::BANNED, { 4 });
+	ASSERT_EQUAL(*search_server.begin(), 1);
+	ASSERT_EQUAL(*std::prev(search_server.end()), 1000);
+	ASSERT_EQUAL(search_server.FindTopDocuments("white cat"s)[0].id, 1000);
+	ASSERT_EQUAL(search_server.FindTopDocuments("grey"s, DocumentStatus::BANNED)[0].id, 4);
+}
+
+void TestResultCountLimit()
+{
+	SearchServer search_server("and with"s);
+	for (int id = 0; id < 20; ++id)
+	{
+		search_server.AddDocument(id, "white cat"s, DocumentStatus::ACTUAL, { id % 4 });
+	}
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	ASSERT(search_server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 0).empty());
+
+	// Equal relevance: rating descending, then ID ascending
+	const auto found_docs = search_server.FindTopDocuments(std::execution::par, "cat"s, DocumentStatus::ACTUAL, 7);
+	const std::vector<int> expected_ids = { 3, 7, 11, 15, 19, 2, 6 };
+	ASSERT_EQUAL(found_docs.size(), expected_ids.size());
+	for (size_t i = 0; i < expected_ids.size(); ++i)
+	{
+		ASSERT_EQUAL(found_docs[i].id, expected_ids[i]);
+	}
+	ASSERT_EQUAL(search_server.FindTopDocuments("cat"s, [](int document_id, DocumentStatus status, int rating) { return rating == 0; }, 100).size(), static_cast<size_t>(5));
+}
+
+void TestTermDictionary()
+{
+	TermDictionary dictionary;
+	{
+		// The dictionary keeps its own copy of the text, the source may go away
+		std::string word = "cat"s;
+		ASSERT_EQUAL(dictionary.Intern(word), 0u);
+		word = "dog"s;
+		ASSERT_EQUAL(dictionary.Intern(word), 1u);
+	}
+	ASSERT_EQUAL(dictionary.Intern("cat"s), 0u);
+	ASSERT_EQUAL(dictionary.GetWord(0), "cat"sv);
+	ASSERT_EQUAL(dictionary.GetWord(1), "dog"sv);
+	ASSERT(dictionary.Find("dog"sv) == std::optional<TermId>(1));
+	ASSERT(!dictionary.Find("parrot"sv));
+
+	// A released ID is empty until the next new word takes it
+	dictionary.Release(0);
+	ASSERT(!dictionary.Find("cat"sv));
+	ASSERT(dictionary.GetWord(0).empty());
+	ASSERT_EQUAL(dictionary.GetTermCount(), static_cast<size_t>(2));
+	ASSERT_EQUAL(dictionary.GetWordCount(), static_cast<size_t>(1));
+	ASSERT_EQUAL(dictionary.Intern("parrot"s), 0u);
+	ASSERT_EQUAL(dictionary.Intern("cat"s), 2u);
+
+	// Keys of a copy point into its own strings
+	TermDictionary copy;
+	{
+		const TermDictionary original = dictionary;
+		copy = original;
+	}
+	for (const std::string_view word : { "parrot"sv, "dog"sv, "cat"sv })
+	{
+		const auto term_id = copy.Find(word);
+		ASSERT(term_id && *term_id == *dictionary.Find(word));
+		ASSERT_EQUAL(copy.GetWord(*term_id), word);
+	}
+	ASSERT_EQUAL(copy.GetWordCount(), static_cast<size_t>(3));
+}
+
+void TestPostingListRoundTrip()
+{
+	// Every way of reading the list must give back exactly the postings put in
+	const auto check_postings = [](const PostingList& postings, const std::map<int, uint32_t>& expected)
+	{
+		ASSERT_EQUAL(postings.Size(), expected.size());
+		auto expected_it = expected.begin();
+		postings.ForEach([&expected, &expected_it](int document_id, uint32_t term_count)
+			{
+				ASSERT(expected_it != expected.end());
+				ASSERT_EQUAL(document_id, expected_it->first);
+				ASSERT_EQUAL(term_count, expected_it->second);
+				++expected_it;
+			});
+		ASSERT(expected_it == expected.end());
+
+		PostingList::Cursor cursor(postings);
+		for (const auto& [document_id, term_count] : expected)
+		{
+			ASSERT_EQUAL(cursor.GetDocumentId(), document_id);
+			ASSERT_EQUAL(cursor.GetTermCount(), term_count);
+			cursor.Next();
+		}
+		ASSERT(cursor.IsEnd());
+
+		PostingList::Cursor skipping_cursor(postings);
+		for (auto it = expected.begin(); it != expected.end(); std::advance(it, std::min<ptrdiff_t>(37, std::distance(it, expected.end()))))
+		{
+			skipping_cursor.NextGeq(it->first == 0 ? 0 : it->first - 1);
+			ASSERT_EQUAL(skipping_cursor.GetDocumentId(), expected.lower_bound(it->first - 1)->first);
+			skipping_cursor.NextGeq(it->first);
+			ASSERT_EQUAL(skipping_cursor.GetDocumentId(), it->first);
+			ASSERT_EQUAL(skipping_cursor.GetTermCount(), it->second);
+		}
+
+		for (const auto& [document_id, term_count] : expected)
+		{
+			ASSERT(postings.Contains(document_id));
+			ASSERT_EQUAL(postings.Contains(document_id + 1), expected.count(document_id + 1) > 0);
+		}
+	};
+
+	PostingList postings;
+	std::map<int, uint32_t> expected;
+	const auto add = [&postings, &expected](int document_id, uint32_t term_count)
+	{
+		postings.Add(document_id, term_count, 0.5);
+		expected[document_id] = term_count;
+	};
+
+	// Gaps and counts below 128 give one-byte blocks
+	for (int id = 0; id < 1200; id += 3)
+	{
+		add(id, id % 100 + 1);
+	}
+	// Gaps and counts of 128 and more need longer values, here some blocks mix both kinds
+	for (int id = 1200, i = 0; i < 600; ++i)
+	{
+		id += i % 10 == 0 ? 129 + i * 50 : 2;
+		add(id, i % 17 == 0 ? 128 + i * 1000 : 5);
+	}
+	add(INT_MAX - 1, UINT32_MAX);
+	check_postings(postings, expected);
+
+	// Inserts in the middle wait in the buffer and are merged into the blocks on the fly
+	std::mt19937 generator(3);
+	const int max_buffered_id = std::prev(expected.end(), 2)->first;
+	while (expected.size() < 1100)
+	{
+		const int id = std::uniform_int_distribution<int>(0, max_buffered_id)(generator);
+		if (!expected.count(id))
+		{
+			add(id, std::uniform_int_distribution<uint32_t>(1, 300)(generator));
+		}
+	}
+	check_postings(postings, expected);
+	// Enough of them fill the buffer, which is then compressed into the blocks
+	while (expected.size() < 1400)
+	{
+		const int id = std::uniform_int_distribution<int>(0, max_buffered_id)(generator);
+		if (!expected.count(id))
+		{
+			add(id, std::uniform_int_distribution<uint32_t>(1, 300)(generator));
+		}
+	}
+	check_postings(postings, expected);
+	postings.ShrinkToFit();
+	check_postings(postings, expected);
+
+	std::vector<bool> is_erased(max_buffered_id + 1);
+	size_t erased_count = 0;
+	for (auto it = expected.begin(); it != expected.end();)
+	{
+		if (it->first <= max_buffered_id && it->first % 5 == 0)
+		{
+			is_erased[it->first] = true;
+			it = expected.erase(it);
+			++erased_count;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	ASSERT_EQUAL(postings.EraseMarked(is_erased), erased_count);
+	check_postings(postings, expected);
+	ASSERT(postings.Erase(INT_MAX - 1));
+	ASSERT(!postings.Erase(INT_MAX - 1));
+	expected.erase(INT_MAX - 1);
+	const int first_id = expected.begin()->first;
+	ASSERT(postings.Erase(first_id));
+	expected.erase(first_id);
+	check_postings(postings, expected);
+}
+
+void TestScoreAccumulator()
+{
+	using Scores = std::vector<std::pair<uint32_t, double>>;
+	const auto get_scores = [](const ScoreAccumulator& accumulator)
+	{
+		Scores scores;
+		accumulator.ForEach([&scores](uint32_t slot, double relevance)
+			{
+				scores.emplace_back(slot, relevance);
+			});
+		return scores;
+	};
+
+	// Relevance is summed per slot, the slots come in the order they were first touched
+	ScoreAccumulator accumulator;
+	accumulator.Reset(10);
+	ASSERT(get_scores(accumulator).empty());
+	accumulator.Add(7, 0.5);
+	accumulator.Add(3, 1.0);
+	accumulator.Add(7, 0.25);
+	ASSERT(get_scores(accumulator) == Scores({ { 7, 0.75 }, { 3, 1.0 } }));
+
+	// A new query does not see the sums of the previous one, also after the array grows
+	accumulator.Reset(10);
+	ASSERT(get_scores(accumulator).empty());
+	accumulator.Add(3, 2.0);
+	ASSERT(get_scores(accumulator) == Scores({ { 3, 2.0 } }));
+	accumulator.Reset(1000);
+	accumulator.Add(999, 1.5);
+	accumulator.Add(7, 0.5);
+	ASSERT(get_scores(accumulator) == Scores({ { 999, 1.5 }, { 7, 0.5 } }));
+
+	// Each thread has its own scratchpad, reused by its queries
+	ScoreAccumulator* const main_accumulator = &ScoreAccumulator::ForCurrentThread();
+	ASSERT(&ScoreAccumulator::ForCurrentThread() == main_accumulator);
+	ScoreAccumulator* other_accumulator = nullptr;
+	std::thread([&other_accumulator]
+		{
+			other_accumulator = &ScoreAccumulator::ForCurrentThread();
+		}).join();
+	ASSERT(other_accumulator != main_accumulator);
+}
+
+void TestBlockMaxWandMatchesExhaustiveSearch()
+{
+	const std::vector<std::string> words = { "cat"s, "dog"s, "bird"s, "fish"s, "white"s, "black"s, "big"s, "small"s, "tail"s, "eyes"s, "fur"s, "collar"s };
+	std::mt19937 generator;
+	const std::vector<std::string> texts = MakeRandomTexts(generator, words, 3'000, 12);
+	SearchServer search_server("and with"s);
+	for (int id = 0; id < 3'000; ++id)
+	{
+		const DocumentStatus status = static_cast<DocumentStatus>(std::uniform_int_distribution(0, 3)(generator));
+		search_server.AddDocument(id, texts[id], status, { std::uniform_int_distribution(-5, 5)(generator) });
+	}
+	for (int id = 0; id < 3'000; id += 7)
+	{
+		search_server.RemoveDocument(id); // Block bounds stay as they were before the removal
+	}
+
+	const std::vector<std::string> queries = { "cat"s, "cat dog"s, "white cat -dog"s, "big small fur eyes tail"s, "fish -fish"s, "collar collar bird -white -black"s, "mouse"s };
+	for (const std::string& query : queries)
+	{
+		for (const size_t max_result_count : { 1, 5, 50, 3'000 })
+		{
+			AssertSameDocuments(search_server.FindTopDocuments(BLOCK_MAX_WAND, query, DocumentStatus::ACTUAL, max_result_count),
+				search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, max_result_count), EPSILON);
+		}
+		const auto is_even_rating = [](int document_id, DocumentStatus status, int rating) { return rating % 2 == 0; };
+		AssertSameDocuments(search_server.FindTopDocuments(BLOCK_MAX_WAND, query, is_even_rating, 10), search_server.FindTopDocuments(query, is_even_rating, 10), EPSILON);
+	}
+
+	// Near ties: about a thousand filler words make relevances of neighbouring lengths differ by less than EPSILON,
+	// while the whole range of lengths spans many EPSILONs. The documents are found in another order than by exhaustive search
+	for (unsigned seed = 0; seed < 100; ++seed)
+	{
+		std::mt19937 tie_generator(seed);
+		SearchServer tied_server("and"s);
+		for (int id = 0; id < 400; ++id)
+		{
+			const int filler_word_count = 1'000 + std::uniform_int_distribution(0, 40)(tie_generator);
+			const int kind = std::uniform_int_distribution(0, 2)(tie_generator);
+			std::string text = kind == 0 ? "cat"s : kind == 1 ? "fox"s : "cat fox"s;
+			for (int i = 0; i < filler_word_count; ++i)
+			{
+				text += " dog"s;
+			}
+			tied_server.AddDocument(id, text, DocumentStatus::ACTUAL, { std::uniform_int_distribution(-5, 5)(tie_generator) });
+		}
+		for (int id = 400; id < 460; ++id)
+		{
+			tied_server.AddDocument(id, "bird dog"s, DocumentStatus::ACTUAL, { 1 });
+		}
+		for (const size_t max_result_count : { 1, 3, 5, 10 })
+		{
+			AssertSameDocuments(tied_server.FindTopDocuments(BLOCK_MAX_WAND, "cat fox"s, DocumentStatus::ACTUAL, max_result_count),
+				tied_server.FindTopDocuments("cat fox"s, DocumentStatus::ACTUAL, max_result_count));
+		}
+	}
+}
+
+void TestParallelSearchMatchesSequential()
+{
+	// Enough documents for the parallel version to split the slots into several ranges
+	const std::vector<std::string> words = { "cat"s, "dog"s, "bird"s, "fish"s, "white"s, "black"s, "big"s, "small"s };
+	std::mt19937 generator;
+	const std::vector<std::string> texts = MakeRandomTexts(generator, words, 20'000, 6);
+	SearchServer search_server("and with"s);
+	for (int id = 0; id < 20'000; ++id)
+	{
+		search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { std::uniform_int_distribution(-5, 5)(generator) });
+	}
+
+	for (const std::string& query : { "cat"s, "white cat -dog"s, "big small fish bird -black"s })
+	{
+		for (const size_t max_result_count : { 1, 5, 100 })
+		{
+			AssertSameDocuments(search_server.FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL, max_result_count),
+				search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, max_result_count));
+		}
+	}
+}
+
+void TestDocumentFilterMatchesPredicate()
+{
+	const std::vector<std::string> words = { "cat"s, "dog"s, "bird"s, "white"s, "black"s, "tail"s };
+	std::mt19937 generator;
+	const std::vector<std::string> texts = MakeRandomTexts(generator, words, 3'000, 6);
+	SearchServer search_server("and with"s);
+	for (int id = 0; id < 3'000; ++id)
+	{
+		const DocumentStatus status = static_cast<DocumentStatus>(std::uniform_int_distribution(0, 3)(generator));
+		search_server.AddDocument(id, texts[id], status, { std::uniform_int_distribution(-50, 50)(generator) });
+	}
+	for (int id = 0; id < 3'000; id += 5)
+	{
+		search_server.RemoveDocument(id);
+	}
+
+	// Narrow filters are scored from the rating index, wide ones fall back to reading the postings
+	const std::vector<DocumentFilter> filters = { {}, { StatusSet().set(static_cast<size_t>(DocumentStatus::BANNED)), 48, 50 },
+		{ StatusSet().set(static_cast<size_t>(DocumentStatus::ACTUAL)).set(static_cast<size_t>(DocumentStatus::REMOVED)), -3, 3 }, { StatusSet().set(), 10, -10 } };
+	for (const DocumentFilter& filter : filters)
+	{
+		const auto predicate = [&filter](int document_id, DocumentStatus status, int rating)
+		{
+			return filter.statuses.test(static_cast<size_t>(status)) && rating >= filter.min_rating && rating <= filter.max_rating;
+		};
+		for (const std::string& query : { "cat"s, "white cat -dog"s, "tail bird -white -black"s })
+		{
+			const auto expected = search_server.FindTopDocuments(query, predicate, 20);
+			for (const auto& found : { search_server.FindTopDocuments(query, filter, 20), search_server.FindTopDocuments(std::execution::par, query, filter, 20),
+				search_server.FindTopDocuments(BLOCK_MAX_WAND, query, filter, 20) })
+			{
+				AssertSameDocuments(found, expected, EPSILON);
+			}
+		}
+	}
+}
+
+void TestPreparedQuery()
+{
+	SearchServer search_server = AddFewDocsForTests();
+	const SearchServer::PreparedQuery query = search_server.PrepareQuery("fluffy well-groomed cat -collar parrot cat"s);
+	const auto expected = search_server.FindTopDocuments("fluffy well-groomed cat -collar parrot cat"s);
+	for (const auto& found : { search_server.FindTopDocuments(query), search_server.FindTopDocuments(std::execution::par, query),
+		search_server.FindTopDocuments(BLOCK_MAX_WAND, query, DocumentStatus::ACTUAL), search_server.FindTopDocuments(query, DocumentFilter{}) })
+	{
+		AssertSameDocuments(found, expected);
+	}
+	ASSERT(std::get<0>(search_server.MatchDocument(query, 2)) == std::get<0>(search_server.MatchDocument("fluffy well-groomed cat -collar parrot cat"s, 2)));
+
+	// After the index changes the words are looked up again: the new word is found and IDFs follow the document count
+	search_server.AddDocument(100, "parrot"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.RemoveDocument(3);
+	const auto expected_after = search_server.FindTopDocuments("fluffy well-groomed cat -collar parrot"s);
+	AssertSameDocuments(search_server.FindTopDocuments(query), expected_after);
+	ASSERT_EQUAL(std::get<0>(search_server.MatchDocument(query, 100)).size(), static_cast<size_t>(1));
+
+	// A query prepared by another server is resolved against the server running it
+	SearchServer other_server("and with"s);
+	other_server.AddDocument(0, "parrot"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(other_server.FindTopDocuments(query).size(), static_cast<size_t>(1));
+
+	// Statistics need one count per plus word, each of them between 1 and the document count
+	SearchServer::PreparedQuery query_with_statistics = query;
+	const size_t plus_word_count = query.GetPlusWords().size();
+	for (const SearchServer::QueryStatistics& statistics : { SearchServer::QueryStatistics{ 10, std::vector<int>(plus_word_count - 1, 1) },
+		SearchServer::QueryStatistics{ 10, std::vector<int>(plus_word_count, 0) }, SearchServer::QueryStatistics{ 10, std::vector<int>(plus_word_count, 11) } })
+	{
+		try
+		{
+			query_with_statistics.SetStatistics(statistics);
+			ASSERT_HINT(false, "The statistics are invalid"s);
+		}
+		catch (const std::invalid_argument&)
+		{
+		}
+	}
+	query_with_statistics.SetStatistics({ 10, std::vector<int>(plus_word_count, 10) });
+	for (const Document& document : search_server.FindTopDocuments(query_with_statistics))
+	{
+		ASSERT_EQUAL(document.relevance, 0.0); // Every word is in every document, so every IDF is 0
+	}
+}
+
+void TestQueryResultCache()
+{
+	SearchServer search_server = AddFewDocsForTests();
+	QueryResultCache query_result_cache(search_server, 2);
+	const auto are_same = [](const std::vector<Document>& lhs, const std::vector<Document>& rhs)
+	{
+		return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& lhs, const Document& rhs)
+			{
+				return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+			});
+	};
+	const auto expected = search_server.FindTopDocuments("fluffy cat -collar"s);
+	ASSERT(are_same(query_result_cache.FindTopDocuments("fluffy cat -collar"s), expected));
+	ASSERT_EQUAL(query_result_cache.GetMissCount(), static_cast<size_t>(1));
+
+	// The words are normalized, the sequenced and the parallel search share entries
+	ASSERT(are_same(query_result_cache.FindTopDocuments("cat fluffy -collar cat and"s), expected));
+	ASSERT(are_same(query_result_cache.FindTopDocuments(std::execution::par, "-collar fluffy cat"s), expected));
+	ASSERT_EQUAL(query_result_cache.GetHitCount(), static_cast<size_t>(2));
+	ASSERT_EQUAL(search_server.NormalizeQuery("cat fluffy -collar cat and"s), "cat fluffy -collar "s);
+
+	// Another status, filter or result count is another entry, the least recently used one is dropped
+	ASSERT(are_same(query_result_cache.FindTopDocuments("fluffy cat -collar"s, DocumentStatus::BANNED), search_server.FindTopDocuments("fluffy cat -collar"s, DocumentStatus::BANNED)));
+	ASSERT(are_same(query_result_cache.FindTopDocuments("fluffy cat -collar"s, DocumentFilter{}, 1), search_server.FindTopDocuments("fluffy cat -collar"s, DocumentFilter{}, 1)));
+	ASSERT_EQUAL(query_result_cache.GetSize(), static_cast<size_t>(2));
+	query_result_cache.FindTopDocuments("fluffy cat -collar"s);
+	ASSERT_EQUAL(query_result_cache.GetMissCount(), static_cast<size_t>(4));
+
+	// Results found before the index changed are not returned
+	search_server.AddDocument(100, "fluffy cat"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT(are_same(query_result_cache.FindTopDocuments("fluffy cat -collar"s), search_server.FindTopDocuments("fluffy cat -collar"s)));
+	ASSERT_EQUAL(query_result_cache.GetMissCount(), static_cast<size_t>(5));
+	search_server.RemoveDocument(100);
+	ASSERT(are_same(query_result_cache.FindTopDocuments("fluffy cat -collar"s), expected));
+	ASSERT_EQUAL(query_result_cache.GetMissCount(), static_cast<size_t>(6));
+
+	// Concurrent searches get the same results as the server
+	const std::vector<std::string> queries = { "cat"s, "fluffy cat"s, "cat"s, "dog -collar"s, "cat fluffy"s, "cat"s };
+	const auto found = ProcessQueriesCached(query_result_cache, queries);
+	const auto expected_found = ProcessQueries(search_server, queries);
+	for (size_t i = 0; i < queries.size(); ++i)
+	{
+		ASSERT(are_same(found[i], expected_found[i]));
+	}
+	ASSERT_EQUAL(query_result_cache.GetHitCount() + query_result_cache.GetMissCount(), static_cast<size_t>(14));
+
+	// Block-Max WAND finds the same documents, so it shares the entries
+	query_result_cache.FindTopDocuments("fluffy cat -collar"s);
+	const size_t miss_count = query_result_cache.GetMissCount();
+	ASSERT(are_same(query_result_cache.FindTopDocuments(BLOCK_MAX_WAND, "fluffy cat -collar"s), search_server.FindTopDocuments(BLOCK_MAX_WAND, "fluffy cat -collar"s)));
+	ASSERT_EQUAL(query_result_cache.GetMissCount(), miss_count);
+
+	// An invalid query throws before the lookup
+	try
+	{
+		query_result_cache.FindTopDocuments("fluffy --cat"s);
+		ASSERT_HINT(false, "The query is invalid"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	ASSERT_EQUAL(query_result_cache.GetMissCount(), miss_count);
+}
+
+void TestSplitIntoWords()
+{
+	std::vector<std::string_view> words;
+	ASSERT(SplitIntoWords(""s, words) && words.empty());
+	ASSERT(SplitIntoWords("   "s, words) && words.empty());
+	ASSERT(!SplitIntoWords("cat \x1F dog"s, words) && words.size() == 3u); // Words are split even if the text is invalid
+	ASSERT(SplitIntoWords("\xEA\xEE\xF2 \x80"s, words) && words.size() == 2u); // Bytes above 0x7F are letters of the code page
+
+	// Word boundaries and control characters at every position of the vectorized chunks, compared with a plain scan
+	std::mt19937 generator;
+	for (int i = 0; i < 2'000; ++i)
+	{
+		std::string text(std::uniform_int_distribution(0, 80)(generator), 'a');
+		for (char& c : text)
+		{
+			const int kind = std::uniform_int_distribution(0, 99)(generator);
+			c = kind < 30 ? ' ' : kind == 99 ? static_cast<char>(std::uniform_int_distribution(0, 31)(generator)) : static_cast<char>(std::uniform_int_distribution(33, 255)(generator));
+		}
+		std::vector<std::string_view> expected_words;
+		bool expected_valid = true;
+		size_t word_begin = 0;
+		for (size_t pos = 0; pos <= text.size(); ++pos)
+		{
+			if (pos == text.size() || text[pos] == ' ')
+			{
+				if (pos > word_begin)
+				{
+					expected_words.push_back(std::string_view(text).substr(word_begin, pos - word_begin));
+				}
+				word_begin = pos + 1;
+			}
+			else if (static_cast<unsigned char>(text[pos]) < ' ')
+			{
+				expected_valid = false;
+			}
+		}
+		ASSERT_EQUAL(SplitIntoWords(text, words), expected_valid);
+		ASSERT(words == expected_words);
+	}
+}
+
+void TestAddDocumentsMatchesSequential()
+{
+	// Both servers get the same documents and lose the same ones, so the batch also reuses free slots
+	std::mt19937 generator;
+	const std::vector<std::string> texts = MakeRandomTexts(generator, MakeNumberedWords(300), 3'000, 30);
+	SearchServer expected_server("and with"s);
+	SearchServer batch_server("and with"s);
+	for (int id = 0; id < 1'000; ++id)
+	{
+		expected_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id % 7 });
+		batch_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id % 7 });
+	}
+	for (int id = 0; id < 1'000; id += 3)
+	{
+		expected_server.RemoveDocument(id);
+		batch_server.RemoveDocument(id);
+	}
+	std::vector<DocumentRecord> documents;
+	for (int id = 1'000; id < 3'000; ++id)
+	{
+		documents.push_back({ id, texts[id], static_cast<DocumentStatus>(id % DOCUMENT_STATUS_COUNT), { id % 5, -id % 3 } });
+		expected_server.AddDocument(id, texts[id], documents.back().status, documents.back().ratings);
+	}
+	batch_server.AddDocuments(std::execution::par, documents);
+
+	ASSERT_EQUAL(batch_server.GetDocumentCount(), expected_server.GetDocumentCount());
+	ASSERT_EQUAL(batch_server.GetPostingCount(), expected_server.GetPostingCount());
+	ASSERT_EQUAL(batch_server.GetPostingsMemoryUsage(), expected_server.GetPostingsMemoryUsage());
+	ASSERT(std::equal(batch_server.begin(), batch_server.end(), expected_server.begin(), expected_server.end()));
+	for (const int id : expected_server)
+	{
+		ASSERT(batch_server.GetWordFrequencies(id) == expected_server.GetWordFrequencies(id));
+	}
+	for (const std::string& query : { "word1 word2 word3"s, "word10 -word20"s, "word299 word0 word150 word7"s })
+	{
+		const auto expected = expected_server.FindTopDocuments(query, DocumentFilter{}, 50);
+		const auto found = batch_server.FindTopDocuments(query, DocumentFilter{}, 50);
+		AssertSameDocuments(found, expected);
+		for (size_t i = 0; i < found.size(); ++i)
+		{
+			ASSERT_EQUAL(found[i].rating, expected[i].rating);
+		}
+	}
+
+	// A bad document stops the whole batch before anything is added. Texts are literals, records only point to them
+	const int document_count = batch_server.GetDocumentCount();
+	for (const std::vector<DocumentRecord>& bad_documents : { std::vector<DocumentRecord>{ { 5'000, "cat", DocumentStatus::ACTUAL, {} }, { 5'000, "dog", DocumentStatus::ACTUAL, {} } },
+		std::vector<DocumentRecord>{ { 5'000, "cat", DocumentStatus::ACTUAL, {} }, { 1'001, "dog", DocumentStatus::ACTUAL, {} } },
+		std::vector<DocumentRecord>{ { 5'000, "cat", DocumentStatus::ACTUAL, {} }, { 5'001, "d\x12og", DocumentStatus::ACTUAL, {} } } })
+	{
+		try
+		{
+			batch_server.AddDocuments(std::execution::par, bad_documents);
+			ASSERT_HINT(false, "The batch must be rejected"s);
+		}
+		catch (const std::invalid_argument&)
+		{
+		}
+		ASSERT_EQUAL(batch_server.GetDocumentCount(), document_count);
+		ASSERT(batch_server.FindTopDocuments("cat"s).empty());
+	}
+}
+
+void TestSnapshotSearchServer()
+{
+	SnapshotSearchServer search_server(AddFewDocsForTests());
+	std::shared_ptr<const SearchServer> snapshot = search_server.GetSnapshot();
+	const int document_count = snapshot->GetDocumentCount();
+
+	// Changes are not seen until they are published, a held snapshot never changes
+	search_server.AddDocument(100, "fluffy parrot"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocuments({ { 101, "white parrot", DocumentStatus::ACTUAL, { 2 } } });
+	search_server.RemoveDocument(0);
+	ASSERT(search_server.FindTopDocuments("parrot"s).empty());
+	std::thread publisher([&search_server]
+		{
+			search_server.Publish(); // Waits for the snapshot held by this test
+		});
+	while (search_server.GetSnapshot() == snapshot)
+	{
+		std::this_thread::yield();
+	}
+	ASSERT_EQUAL(snapshot->GetDocumentCount(), document_count);
+	ASSERT(snapshot->FindTopDocuments("parrot"s).empty());
+	ASSERT_EQUAL(search_server.FindTopDocuments("parrot"s).size(), 2u);
+	ASSERT_EQUAL(search_server.GetSnapshot()->GetDocumentCount(), document_count + 1);
+
+	// The second copy gets the same changes once the old readers are gone
+	const uint64_t snapshot_epoch = snapshot->GetIndexEpoch();
+	snapshot.reset();
+	publisher.join();
+	try
+	{
+		search_server.AddDocument(100, "parrot"s, DocumentStatus::ACTUAL, {});
+		ASSERT_HINT(false, "The document is already added"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	search_server.AddDocument(102, "grey parrot"s, DocumentStatus::ACTUAL, { 3 });
+	search_server.Publish();
+	ASSERT_EQUAL(search_server.FindTopDocuments("parrot"s).size(), 3u);
+	search_server.RemoveDocument(102);
+	search_server.Publish();
+	ASSERT_EQUAL(search_server.FindTopDocuments("parrot"s).size(), 2u);
+	ASSERT_EQUAL(search_server.GetSnapshot()->GetDocumentCount(), document_count + 1);
+	ASSERT(search_server.GetSnapshot()->GetIndexEpoch() > snapshot_epoch);
+
+	// Readers running during the changes always see whole batches: every batch adds two documents with the same word
+	std::atomic<bool> is_writing = true;
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 2; ++i)
+	{
+		readers.emplace_back([&search_server, &is_writing, document_count]
+			{
+				while (is_writing)
+				{
+					const auto snapshot = search_server.GetSnapshot();
+					ASSERT_EQUAL((snapshot->GetDocumentCount() - document_count - 1) % 2, 0);
+					ASSERT_EQUAL(snapshot->FindTopDocuments("batch"s, DocumentStatus::ACTUAL, 1000).size() * 2, static_cast<size_t>(snapshot->GetDocumentCount() - document_count - 1));
+				}
+			});
+	}
+	for (int id = 1'000; id < 1'200; id += 2)
+	{
+		search_server.AddDocument(id, "batch"s, DocumentStatus::ACTUAL, { 1 });
+		search_server.AddDocument(id + 1, "batch"s, DocumentStatus::BANNED, { 1 });
+		search_server.Publish();
+	}
+	is_writing = false;
+	for (std::thread& reader : readers)
+	{
+		reader.join();
+	}
+	ASSERT_EQUAL(search_server.FindTopDocuments("batch"s, DocumentStatus::BANNED, 1000).size(), 100u);
+}
+
+void TestSegmentedSearchServer()
+{
+	// Both servers get the same documents and lose the same ones, ratings differ so that ties are broken the same way
+	std::mt19937 generator;
+	const std::vector<std::string> texts = MakeRandomTexts(generator, MakeNumberedWords(100), 1'000, 20);
+	SearchServer expected_server("and with"s);
+	SegmentedSearchServer segmented_server("and with"s, 50);
+	const std::vector<std::string> queries = { "word1 word2 word3"s, "word10 -word20"s, "word99 word0 word50 word7"s };
+	const auto check_results = [&]
+	{
+		ASSERT_EQUAL(segmented_server.GetDocumentCount(), expected_server.GetDocumentCount());
+		for (const std::string& query : queries)
+		{
+			AssertSameDocuments(segmented_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 30), expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 30), EPSILON);
+			AssertSameDocuments(segmented_server.FindTopDocuments(query, DocumentStatus::BANNED, 30), expected_server.FindTopDocuments(query, DocumentStatus::BANNED, 30), EPSILON);
+		}
+	};
+	for (int id = 0; id < 1'000; ++id)
+	{
+		const DocumentStatus status = id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+		expected_server.AddDocument(id, texts[id], status, { id });
+		segmented_server.AddDocument(id, texts[id], status, { id });
+		if (id % 3 == 0 && id >= 100)
+		{
+			expected_server.RemoveDocument(id - 100); // Mostly from frozen segments, some of them being merged
+			segmented_server.RemoveDocument(id - 100);
+		}
+		if (id % 250 == 0)
+		{
+			check_results();
+		}
+	}
+	segmented_server.WaitForMerges();
+	ASSERT(segmented_server.GetSegmentCount() < 1'000u / 50u);
+	check_results();
+
+	// A removed document may come back, a present one may not be added again
+	segmented_server.AddDocument(2, "word1 word2"s, DocumentStatus::ACTUAL, { 2'000 });
+	expected_server.AddDocument(2, "word1 word2"s, DocumentStatus::ACTUAL, { 2'000 });
+	try
+	{
+		segmented_server.AddDocument(1, "word1"s, DocumentStatus::ACTUAL, {});
+		ASSERT_HINT(false, "The document is already added"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	try
+	{
+		segmented_server.RemoveDocument(5);
+		ASSERT_HINT(false, "The document is already removed"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	check_results();
+	const auto found = segmented_server.FindTopDocuments("word3"s, [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; }, 1'000);
+	ASSERT_EQUAL(found.size(), expected_server.FindTopDocuments("word3"s, [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; }, 1'000).size());
+}
+
+void TestRemoveDocumentsMatchesEagerRemoval()
+{
+	// Both servers lose the same documents, one of them one by one and the other by marks purged later
+	std::mt19937 generator;
+	const std::vector<std::string> texts = MakeRandomTexts(generator, MakeNumberedWords(200), 2'000, 30);
+	SearchServer expected_server("and with"s);
+	SearchServer marked_server("and with"s);
+	for (int id = 0; id < 2'000; ++id)
+	{
+		const DocumentStatus status = static_cast<DocumentStatus>(id % DOCUMENT_STATUS_COUNT);
+		expected_server.AddDocument(id, texts[id], status, { id });
+		marked_server.AddDocument(id, texts[id], status, { id });
+	}
+	std::vector<int> removed_ids;
+	for (int id = 0; id < 2'000; ++id)
+	{
+		if (id % 3 == 0 || (id > 500 && id < 900))
+		{
+			removed_ids.push_back(id);
+			expected_server.RemoveDocument(id);
+		}
+	}
+	const uint64_t epoch = marked_server.GetIndexEpoch();
+	marked_server.RemoveDocuments(removed_ids);
+	ASSERT(marked_server.GetIndexEpoch() != epoch);
+	ASSERT_EQUAL(marked_server.GetRemovedDocumentCount(), removed_ids.size());
+
+	const auto check_results = [&expected_server, &marked_server]
+	{
+		ASSERT_EQUAL(marked_server.GetDocumentCount(), expected_server.GetDocumentCount());
+		ASSERT(std::equal(marked_server.begin(), marked_server.end(), expected_server.begin(), expected_server.end()));
+		DocumentFilter filter;
+		filter.min_rating = 1'500;
+		for (const std::string& query : { "word1 word2 word3"s, "word10 -word20"s, "word199 word0 word150 word7"s })
+		{
+			const auto expected = expected_server.FindTopDocuments(query, DocumentFilter{}, 50);
+			const std::vector<std::vector<Document>> found_lists = { marked_server.FindTopDocuments(query, DocumentFilter{}, 50),
+				marked_server.FindTopDocuments(std::execution::par, query, DocumentFilter{}, 50),
+				marked_server.FindTopDocuments(BLOCK_MAX_WAND, query, DocumentFilter{}, 50) };
+			for (const auto& found : found_lists)
+			{
+				AssertSameDocuments(found, expected);
+			}
+			ASSERT_EQUAL(marked_server.FindTopDocuments(query, filter, 50).size(), expected_server.FindTopDocuments(query, filter, 50).size());
+		}
+	};
+	check_results();
+	try
+	{
+		marked_server.MatchDocument("word1"s, 3);
+		ASSERT_HINT(false, "The document is removed"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+
+	// A removed ID may be added again before the purge, its old postings stay marked
+	expected_server.AddDocument(3, "word1 word2"s, DocumentStatus::ACTUAL, { 5'000 });
+	marked_server.AddDocument(3, "word1 word2"s, DocumentStatus::ACTUAL, { 5'000 });
+	check_results();
+
+	marked_server.PurgeRemovedDocuments(std::execution::par);
+	ASSERT_EQUAL(marked_server.GetRemovedDocumentCount(), 0u);
+	ASSERT_EQUAL(marked_server.GetPostingCount(), expected_server.GetPostingCount());
+	check_results();
+
+	// A bad ID stops the whole batch
+	for (const std::vector<int>& bad_ids : { std::vector<int>{ 1, 1 }, std::vector<int>{ 1, 3'000 } })
+	{
+		try
+		{
+			marked_server.RemoveDocuments(bad_ids);
+			ASSERT_HINT(false, "The batch must be rejected"s);
+		}
+		catch (const std::invalid_argument&)
+		{
+		}
+		ASSERT_EQUAL(marked_server.GetRemovedDocumentCount(), 0u);
+		ASSERT(marked_server.HasDocument(1));
+	}
+}
+
+void TestCompactAndUnusedWords()
+{
+	// A word goes away with the postings of its last document, a new word takes its ID
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "black dog"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.AddDocument(3, "black cat"s, DocumentStatus::BANNED, { 3 });
+	ASSERT_EQUAL(search_server.GetWordCount(), 4u);
+	search_server.RemoveDocument(1);
+	ASSERT_EQUAL(search_server.GetWordCount(), 3u);
+	search_server.RemoveDocuments({ 2 });
+	ASSERT_EQUAL(search_server.GetWordCount(), 3u);
+	search_server.PurgeRemovedDocuments();
+	ASSERT_EQUAL(search_server.GetWordCount(), 2u);
+	ASSERT(search_server.FindTopDocuments("white dog"s).empty());
+	search_server.AddDocument(4, "grey parrot"s, DocumentStatus::ACTUAL, { 4 });
+	ASSERT_EQUAL(search_server.GetWordCount(), 4u);
+	const auto found = search_server.FindTopDocuments("white grey cat"s, DocumentFilter{});
+	ASSERT_EQUAL(found.size(), 2u);
+	ASSERT(std::isfinite(found[0].relevance) && std::isfinite(found[1].relevance));
+
+	// After heavy churn the compacted index serves the same results as one built from the remaining documents
+	std::mt19937 generator;
+	std::vector<std::string> texts;
+	for (int id = 0; id < 3'000; ++id)
+	{
+		std::string text;
+		const int word_count = std::uniform_int_distribution(1, 20)(generator);
+		for (int i = 0; i < word_count; ++i)
+		{
+			text += "word"s + std::to_string(std::uniform_int_distribution(0, id / 2)(generator)) + " "s;
+		}
+		texts.push_back(text);
+	}
+	SearchServer churned_server("and with"s);
+	SearchServer expected_server("and with"s);
+	for (int id = 0; id < 3'000; ++id)
+	{
+		churned_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+		if (id % 10 == 9)
+		{
+			expected_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+		}
+		else if (id % 2 == 0)
+		{
+			churned_server.RemoveDocument(id);
+		}
+	}
+	std::vector<int> removed_ids;
+	for (int id = 1; id < 3'000; id += 2)
+	{
+		if (id % 10 != 9)
+		{
+			removed_ids.push_back(id);
+		}
+	}
+	churned_server.RemoveDocuments(removed_ids);
+	const SearchServer::PreparedQuery query = churned_server.PrepareQuery("word1 word2 word99 word900 -word7"s);
+	const size_t memory_usage = churned_server.GetPostingsMemoryUsage();
+	churned_server.Compact();
+	ASSERT_EQUAL(churned_server.GetRemovedDocumentCount(), 0u);
+	ASSERT_EQUAL(churned_server.GetWordCount(), expected_server.GetWordCount());
+	ASSERT_EQUAL(churned_server.GetPostingCount(), expected_server.GetPostingCount());
+	ASSERT(churned_server.GetPostingsMemoryUsage() < memory_usage);
+	AssertSameDocuments(churned_server.FindTopDocuments(query, DocumentFilter{}, 50), expected_server.FindTopDocuments("word1 word2 word99 word900 -word7"s, DocumentFilter{}, 50));
+	AssertSameDocuments(churned_server.FindTopDocuments("word5 word1400"s, DocumentFilter{}, 50), expected_server.FindTopDocuments("word5 word1400"s, DocumentFilter{}, 50));
+	churned_server.AddDocument(0, "word1 word2"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(churned_server.GetDocumentCount(), expected_server.GetDocumentCount() + 1);
+}
+
+void TestQueryExecutor()
+{
+	SearchServer search_server = AddFewDocsForTests();
+	std::vector<std::string> queries;
+	for (int i = 0; i < 500; ++i)
+	{
+		queries.push_back(i % 3 == 0 ? "fluffy cat -collar"s : i % 3 == 1 ? "well-groomed parrot dog"s : "word"s + std::to_string(i));
+	}
+	const auto expected = ProcessQueries(search_server, queries);
+	for (const size_t thread_count : { 1u, 4u })
+	{
+		QueryExecutor query_executor(thread_count);
+		ASSERT_EQUAL(query_executor.GetThreadCount(), thread_count);
+		for (int batch = 0; batch < 3; ++batch)
+		{
+			const auto found = query_executor.ProcessQueries(search_server, queries);
+			ASSERT_EQUAL(found.size(), expected.size());
+			for (size_t i = 0; i < found.size(); ++i)
+			{
+				AssertSameDocuments(found[i], expected[i]);
+			}
+			ASSERT_EQUAL(query_executor.GetLastBatchStatistics().task_count, queries.size());
+		}
+		const auto joined = query_executor.ProcessQueriesJoined(search_server, queries);
+		const auto expected_joined = ProcessQueriesJoined(search_server, queries);
+		ASSERT(std::equal(joined.begin(), joined.end(), expected_joined.begin(), expected_joined.end(), [](const Document& lhs, const Document& rhs)
+			{
+				return lhs.id == rhs.id && lhs.relevance == rhs.relevance;
+			}));
+
+		// Every task runs once however the ranges are stolen, heavy tasks are all at the start of the batch
+		std::vector<std::atomic<int>> run_counts(1'000);
+		query_executor.Run(run_counts.size(), [&run_counts](size_t index)
+			{
+				if (index < 10)
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				}
+				++run_counts[index];
+			});
+		ASSERT(std::all_of(run_counts.begin(), run_counts.end(), [](const std::atomic<int>& run_count) { return run_count == 1; }));
+
+		// A bad query fails the batch in the caller, the executor keeps working
+		queries.push_back("fluffy --cat"s);
+		try
+		{
+			query_executor.ProcessQueries(search_server, queries);
+			ASSERT_HINT(false, "The batch must fail"s);
+		}
+		catch (const std::invalid_argument&)
+		{
+		}
+		queries.pop_back();
+		ASSERT_EQUAL(query_executor.ProcessQueries(search_server, queries).size(), queries.size());
+	}
+}
+
+void TestJoinedResults()
+{
+	// Slices of the queries hold their results in order, empty results leave no gaps
+	SearchServer search_server = AddFewDocsForTests();
+	const std::vector<std::string> queries = { "fluffy cat"s, "unknown"s, "well-groomed dog -collar"s, ""s, "cat parrot dog"s };
+	const auto expected = ProcessQueries(search_server, queries);
+	const JoinedResults joined = ProcessQueriesJoined(search_server, queries);
+	ASSERT_EQUAL(joined.GetQueryCount(), queries.size());
+	size_t document_count = 0;
+	auto joined_it = joined.begin();
+	for (size_t i = 0; i < queries.size(); ++i)
+	{
+		const auto query_documents = joined.GetQueryDocuments(i);
+		ASSERT_EQUAL(static_cast<size_t>(query_documents.Size()), expected[i].size());
+		ASSERT(query_documents.Begin() == joined_it);
+		for (size_t j = 0; j < expected[i].size(); ++j, ++joined_it)
+		{
+			ASSERT_EQUAL(joined_it->id, expected[i][j].id);
+			ASSERT_EQUAL(joined_it->relevance, expected[i][j].relevance);
+		}
+		document_count += expected[i].size();
+	}
+	ASSERT(joined_it == joined.end());
+	ASSERT_EQUAL(joined.size(), document_count);
+	ASSERT(ProcessQueriesJoined(search_server, {}).empty());
+}
+
+void TestAsyncQueryExecutor()
+{
+	SearchServer search_server = AddFewDocsForTests();
+	const std::vector<std::string> queries = { "fluffy cat"s, "cat fluffy"s, "well-groomed dog -collar"s, "parrot"s, "fluffy cat"s };
+	std::vector<std::future<std::vector<Document>>> futures;
+	std::vector<size_t> query_indexes;
+	size_t rejected_count = 0;
+	{
+		AsyncQueryExecutor query_executor(search_server, 2, 8, 4);
+		for (int i = 0; i < 100; ++i)
+		{
+			futures.push_back(query_executor.Submit(queries[i % queries.size()]));
+			query_indexes.push_back(i % queries.size());
+			ASSERT(query_executor.GetQueueSize() <= 8u);
+		}
+		for (int i = 0; i < 100; ++i)
+		{
+			if (auto future = query_executor.TrySubmit(queries[i % queries.size()], DocumentStatus::ACTUAL))
+			{
+				futures.push_back(std::move(*future));
+				query_indexes.push_back(i % queries.size());
+			}
+			else
+			{
+				++rejected_count; // The queue is full, nothing is admitted
+			}
+		}
+		ASSERT_EQUAL(futures.size() + rejected_count, 200u);
+
+		// An invalid query fails only its own future
+		auto bad_future = query_executor.Submit("fluffy --cat"s);
+		auto good_future = query_executor.Submit("parrot"s, DocumentStatus::BANNED);
+		try
+		{
+			bad_future.get();
+			ASSERT_HINT(false, "The query is invalid"s);
+		}
+		catch (const std::invalid_argument&)
+		{
+		}
+		ASSERT_EQUAL(good_future.get().size(), search_server.FindTopDocuments("parrot"s, DocumentStatus::BANNED).size());
+	} // Admitted queries are finished before the executor is gone
+
+	for (size_t i = 0; i < futures.size(); ++i)
+	{
+		const auto found = futures[i].get();
+		AssertSameDocuments(found, search_server.FindTopDocuments(queries[query_indexes[i]]));
+	}
+}
+
+void TestRequestStatistics()
+{
+	using namespace std::chrono_literals;
+	using Clock = RequestStatistics::Clock;
+
+	// Threads record at once, no request is lost
+	{
+		RequestStatistics statistics(2);
+		const Clock::time_point time = Clock::now();
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; ++i)
+		{
+			threads.emplace_back([&statistics, time]
+				{
+					for (size_t j = 0; j < 1'000; ++j)
+					{
+						statistics.Record(100us, j % 7, time);
+					}
+				});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		const auto summary = statistics.GetSummary(RequestStatistics::Window::MINUTE, time);
+		ASSERT_EQUAL(summary.request_count, 4'000u);
+		ASSERT_EQUAL(summary.no_result_request_count, 4 * 143u);
+		ASSERT_EQUAL(summary.result_count_distribution.size(), MAX_RESULT_DOCUMENT_COUNT + 2);
+		ASSERT_EQUAL(summary.result_count_distribution.back(), 4 * 142u); // 6 documents found
+		ASSERT(std::abs(summary.GetNoResultRate() - 0.143) < 1e-9);
+	}
+
+	// Percentiles are upper bounds of their bins, at most a quarter above the latency
+	{
+		RequestStatistics statistics(1);
+		const Clock::time_point time = Clock::now();
+		for (int i = 0; i < 990; ++i)
+		{
+			statistics.Record(100us, 1, time);
+		}
+		for (int i = 0; i < 10; ++i)
+		{
+			statistics.Record(10ms, 1, time);
+		}
+		const auto summary = statistics.GetSummary(RequestStatistics::Window::HOUR, time);
+		ASSERT(summary.latency_p50 >= 100us && summary.latency_p50 <= 125us);
+		ASSERT(summary.latency_p99 >= 100us && summary.latency_p99 <= 125us);
+		ASSERT(summary.latency_p999 >= 10ms && summary.latency_p999 <= 12'500us);
+		ASSERT_EQUAL(summary.no_result_request_count, 0u);
+	}
+
+	// Latencies past the last octave are not mixed into its top bin
+	{
+		RequestStatistics statistics(1);
+		const Clock::time_point time = Clock::now();
+		statistics.Record(std::chrono::nanoseconds((1ll << 37) - 1), 1, time);
+		ASSERT(statistics.GetSummary(RequestStatistics::Window::MINUTE, time).latency_p999 == std::chrono::nanoseconds(1ll << 37));
+		statistics.Record(10min, 1, time);
+		ASSERT(statistics.GetSummary(RequestStatistics::Window::MINUTE, time).latency_p999 == Clock::duration::max());
+	}
+
+	// Requests leave the windows as time passes
+	{
+		RequestStatistics statistics(1);
+		const Clock::time_point time = Clock::now();
+		statistics.Record(1ms, 0, time);
+		statistics.Record(1ms, 3, time + 2min);
+		const auto count = [&statistics](RequestStatistics::Window window, Clock::time_point now)
+		{
+			return statistics.GetSummary(window, now).request_count;
+		};
+		ASSERT_EQUAL(count(RequestStatistics::Window::MINUTE, time + 2min + 1s), 1u);
+		ASSERT_EQUAL(count(RequestStatistics::Window::MINUTE, time + 4min), 0u);
+		ASSERT_EQUAL(count(RequestStatistics::Window::HOUR, time + 4min), 2u);
+		ASSERT_EQUAL(count(RequestStatistics::Window::HOUR, time + 2h), 0u);
+		ASSERT_EQUAL(count(RequestStatistics::Window::DAY, time + 2h), 2u);
+		ASSERT_EQUAL(count(RequestStatistics::Window::DAY, time + 25h), 0u);
+
+		// A day later the bucket of the first hour is reused, a request of a later hour is still in the window
+		statistics.Record(1ms, 0, time + 2h);
+		statistics.Record(1ms, 0, time + 24h);
+		ASSERT_EQUAL(count(RequestStatistics::Window::DAY, time + 24h), 2u);
+		ASSERT_EQUAL(count(RequestStatistics::Window::DAY, time + 26h), 1u);
+	}
+
+	// RequestQueue records the requests it serves
+	{
+		SearchServer search_server = AddFewDocsForTests();
+		RequestStatistics statistics;
+		RequestQueue request_queue(search_server, &statistics);
+		request_queue.AddFindRequest("fluffy cat"s);
+		request_queue.AddFindRequest("sparrow"s);
+		const auto summary = statistics.GetSummary(RequestStatistics::Window::MINUTE);
+		ASSERT_EQUAL(summary.request_count, 2u);
+		ASSERT_EQUAL(summary.no_result_request_count, 1u);
+		ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1);
+	}
+}
+
+void TestShardedSearchServer()
+{
+	// Both servers get the same documents and lose the same ones, ratings differ so that ties are broken the same way
+	std::mt19937 generator;
+	const std::vector<std::string> texts = MakeRandomTexts(generator, MakeNumberedWords(100), 1'000, 20);
+	const auto get_status = [](int id)
+	{
+		return id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+	};
+
+	SearchServer expected_server("and with"s);
+	ShardedSearchServer sharded_server("and with"s, 4);
+	ASSERT_EQUAL(sharded_server.GetShardCount(), 4u);
+	for (int id = 0; id < 1'000; ++id)
+	{
+		expected_server.AddDocument(id, texts[id], get_status(id), { id });
+	}
+	// Writers of different shards run at once
+	std::vector<std::thread> threads;
+	for (int thread_index = 0; thread_index < 4; ++thread_index)
+	{
+		threads.emplace_back([&, thread_index]
+			{
+				for (int id = thread_index; id < 1'000; id += 4)
+				{
+					sharded_server.AddDocument(id, texts[id], get_status(id), { id });
+				}
+			});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	for (int id = 0; id < 1'000; id += 7)
+	{
+		expected_server.RemoveDocument(id);
+		sharded_server.RemoveDocument(id);
+	}
+
+	ASSERT_EQUAL(sharded_server.GetDocumentCount(), expected_server.GetDocumentCount());
+	for (size_t i = 0; i < sharded_server.GetShardCount(); ++i)
+	{
+		ASSERT(sharded_server.GetShardDocumentCount(i) > 0);
+	}
+	const std::vector<std::string> queries = { "word1 word2 word3"s, "word10 -word20"s, "word99 word0 word50 word7"s, "nothing"s };
+	for (const std::string& query : queries)
+	{
+		const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 30);
+		const auto found = sharded_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 30);
+		const auto found_seq = sharded_server.FindTopDocuments(std::execution::seq, query, [](int, DocumentStatus status, int)
+			{
+				return status == DocumentStatus::ACTUAL;
+			}, 30);
+		AssertSameDocuments(found, expected, EPSILON);
+		AssertSameDocuments(found_seq, expected, EPSILON);
+	}
+
+	// IDs are checked by the shard that holds them
+	try
+	{
+		sharded_server.AddDocument(1, "word1"s, DocumentStatus::ACTUAL, {});
+		ASSERT_HINT(false, "The document is already added"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	try
+	{
+		sharded_server.RemoveDocument(7);
+		ASSERT_HINT(false, "The document is already removed"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+	try
+	{
+		sharded_server.FindTopDocuments("word1 --word2"s);
+		ASSERT_HINT(false, "The query is invalid"s);
+	}
+	catch (const std::invalid_argument&)
+	{
+	}
+}
+
 void TestSearchServer()
 {
 	RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
@@ -259,4 +1524,25 @@ void TestSearchServer()
 	RUN_TEST(TestFilterDocumentsByUsingPredicate);
 	RUN_TEST(TestSearchDocsByStatus);
 	RUN_TEST(TestRelevanceCalculate);
+	RUN_TEST(TestAddAndRemoveDocumentsInAnyOrder);
+	RUN_TEST(TestResultCountLimit);
+	RUN_TEST(TestTermDictionary);
+	RUN_TEST(TestPostingListRoundTrip);
+	RUN_TEST(TestScoreAccumulator);
+	RUN_TEST(TestBlockMaxWandMatchesExhaustiveSearch);
+	RUN_TEST(TestParallelSearchMatchesSequential);
+	RUN_TEST(TestDocumentFilterMatchesPredicate);
+	RUN_TEST(TestPreparedQuery);
+	RUN_TEST(TestQueryResultCache);
+	RUN_TEST(TestSplitIntoWords);
+	RUN_TEST(TestAddDocumentsMatchesSequential);
+	RUN_TEST(TestSnapshotSearchServer);
+	RUN_TEST(TestSegmentedSearchServer);
+	RUN_TEST(TestRemoveDocumentsMatchesEagerRemoval);
+	RUN_TEST(TestCompactAndUnusedWords);
+	RUN_TEST(TestQueryExecutor);
+	RUN_TEST(TestJoinedResults);
+	RUN_TEST(TestAsyncQueryExecutor);
+	RUN_TEST(TestRequestStatistics);
+	RUN_TEST(TestShardedSearchServer);
 }
\ No newline at end of file
@@ -1,5 +1,14 @@
 #pragma once
 #include "search_server.h"
+#include "process_queries.h"
+#include "query_result_cache.h"
+#include "snapshot_search_server.h"
+#include "segmented_search_server.h"
+#include "sharded_search_server.h"
+#include "query_executor.h"
+#include "async_query_executor.h"
+#include "request_queue.h"
+#include "request_statistics.h"
 #include "log_duration.h"
 #include <string>
 #include <random>
@@ -43,6 +52,9 @@ void AssertEqualImpl(const T& t, const U& u, const std::string& t_str, const std
 void TestExcludeStopWordsFromAddedDocumentContent();
 void TestAddDocument();
 SearchServer AddFewDocsForTests();
+std::vector<std::string> MakeNumberedWords(int word_count);
+std::vector<std::string> MakeRandomTexts(std::mt19937& generator, const std::vector<std::string>& words, size_t text_count, int max_word_count);
+void AssertSameDocuments(const std::vector<Document>& found, const std::vector<Document>& expected, double max_relevance_error = 0.0);
 void TestExcludeDocumentsWithMinusWordsFromSearchResults();
 void TestMatchDocuments();
 void TestFoundDocsSortInDescendingOrderOfRelevance();
@@ -50,5 +62,26 @@ void TestRatingCalc();
 void TestFilterDocumentsByUsingPredicate();
 void TestSearchDocsByStatus();
 void TestRelevanceCalculate();
+void TestAddAndRemoveDocumentsInAnyOrder();
+void TestResultCountLimit();
+void TestTermDictionary();
+void TestPostingListRoundTrip();
+void TestScoreAccumulator();
+void TestBlockMaxWandMatchesExhaustiveSearch();
+void TestParallelSearchMatchesSequential();
+void TestDocumentFilterMatchesPredicate();
+void TestPreparedQuery();
+void TestQueryResultCache();
+void TestSplitIntoWords();
+void TestAddDocumentsMatchesSequential();
+void TestSnapshotSearchServer();
+void TestSegmentedSearchServer();
+void TestRemoveDocumentsMatchesEagerRemoval();
+void TestCompactAndUnusedWords();
+void TestQueryExecutor();
+void TestJoinedResults();
+void TestAsyncQueryExecutor();
+void TestRequestStatistics();
+void TestShardedSearchServer();
 void TestSearchServer();
 void ParallelSearchBenchmark();
\ No newline at end of file
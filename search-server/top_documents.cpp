@@ -0,0 +1,79 @@
+#include "top_documents.h"
+#include <algorithm>
+#include <cmath>
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+	const double lhs_step = GetRelevanceStep(lhs.relevance);
+	const double rhs_step = GetRelevanceStep(rhs.relevance);
+	if (lhs_step == rhs_step)
+	{
+		if (lhs.rating != rhs.rating)
+		{
+			return lhs.rating > rhs.rating;
+		}
+		return lhs.id < rhs.id;
+	}
+	return lhs_step > rhs_step;
+}
+
+double GetRelevanceStep(double relevance)
+{
+	return std::floor(relevance / EPSILON);
+}
+
+TopDocuments::TopDocuments(size_t max_count)
+	: max_count_(max_count)
+{}
+
+void TopDocuments::Reset(size_t max_count)
+{
+	max_count_ = max_count;
+	heap_.clear();
+}
+
+void TopDocuments::Add(const Document& document)
+{
+	if (heap_.size() < max_count_)
+	{
+		heap_.push_back(document);
+		std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	}
+	else if (max_count_ > 0 && IsMoreRelevant(document, heap_.front()))
+	{
+		std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		heap_.back() = document;
+		std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	}
+}
+
+void TopDocuments::Merge(const TopDocuments& other)
+{
+	for (const Document& document : other.heap_)
+	{
+		Add(document);
+	}
+}
+
+size_t TopDocuments::Size() const
+{
+	return heap_.size();
+}
+
+bool TopDocuments::IsFull() const
+{
+	return heap_.size() == max_count_;
+}
+
+double TopDocuments::GetMinRelevance() const
+{
+	return heap_.front().relevance;
+}
+
+std::vector<Document> TopDocuments::Extract()
+{
+	std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	std::vector<Document> documents(heap_.begin(), heap_.end()); // Of the exact size, the heap keeps its memory for the next query
+	heap_.clear();
+	return documents;
+}
\ No newline at end of file
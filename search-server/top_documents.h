@@ -0,0 +1,31 @@
+#pragma once
+#include "document.h"
+#include <cstddef>
+#include <vector>
+
+constexpr double EPSILON = 1e-6;
+
+// Relevance descending in steps of EPSILON, documents within one step are ordered by rating descending and then by ID ascending.
+// Unlike relevances merely closer than EPSILON, steps never chain, so this is a strict weak ordering and the top documents
+// of a search do not depend on the order in which the documents are scored
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+double GetRelevanceStep(double relevance); // The whole number of EPSILONs in the relevance, rounded down
+
+// Keeps the max_count most relevant documents out of a stream, so matched documents are never collected and sorted in full
+class TopDocuments
+{
+public:
+	explicit TopDocuments(size_t max_count);
+
+	void Reset(size_t max_count); // Empties the collector for another query and keeps its memory
+	void Add(const Document& document);
+	void Merge(const TopDocuments& other);
+	size_t Size() const;
+	bool IsFull() const; // Whether a new document has to be more relevant than a kept one to get in
+	double GetMinRelevance() const; // Relevance of the least relevant kept document, the collector must not be empty
+	std::vector<Document> Extract(); // Returns a copy of the kept documents from the most relevant one and leaves the collector empty
+
+private:
+	size_t max_count_;
+	std::vector<Document> heap_; // Heap ordered by IsMoreRelevant, so the least relevant kept document is on top
+};
\ No newline at end of file
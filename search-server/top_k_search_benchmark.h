@@ -0,0 +1,98 @@
+#pragma once
+#include "search_server.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "log_duration.h"
+
+#define TOP_K_SEARCH_BENCHMARK(policy) TopKSearchQueries(#policy, policy, search_server, queries)
+
+using namespace std;
+
+template <typename ExecutionPolicy>
+vector<vector<Document>> TopKSearchQueries(string_view mark, ExecutionPolicy&& policy, const SearchServer& search_server, const vector<string>& queries)
+{
+	LOG_DURATION(mark);
+	vector<vector<Document>> documents_lists;
+	documents_lists.reserve(queries.size());
+	for (const string& query : queries)
+	{
+		documents_lists.push_back(search_server.FindTopDocuments(policy, query));
+	}
+	return documents_lists;
+}
+
+string GenerateWordTopKSearch(mt19937& generator, int max_length)
+{
+	const int length = uniform_int_distribution(1, max_length)(generator);
+	string word;
+	word.reserve(length);
+	for (int i = 0; i < length; ++i)
+	{
+		word.push_back(uniform_int_distribution(static_cast<int>('a'), static_cast<int>('z'))(generator));
+	}
+	return word;
+}
+
+// Words are taken with Zipf-like frequencies, so common words have long posting lists as in real texts
+string GenerateTextTopKSearch(mt19937& generator, const vector<string>& dictionary, discrete_distribution<int>& word_distribution, int word_count)
+{
+	string text;
+	for (int i = 0; i < word_count; ++i)
+	{
+		if (!text.empty())
+		{
+			text.push_back(' ');
+		}
+		text += dictionary[word_distribution(generator)];
+	}
+	return text;
+}
+
+int CountMismatchesTopKSearch(const vector<vector<Document>>& expected, const vector<vector<Document>>& found)
+{
+	int mismatch_count = 0;
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		mismatch_count += !equal(found[i].begin(), found[i].end(), expected[i].begin(), expected[i].end(), [](const Document& lhs, const Document& rhs)
+			{
+				return lhs.id == rhs.id && abs(lhs.relevance - rhs.relevance) < EPSILON;
+			});
+	}
+	return mismatch_count;
+}
+
+// Compares exhaustive term-at-a-time scoring, its parallel version and Block-Max WAND on long queries, all must return the same documents
+void TopKSearchBenchmark()
+{
+	mt19937 generator;
+	vector<string> dictionary;
+	vector<double> word_weights;
+	for (int i = 0; i < 5'000; ++i)
+	{
+		dictionary.push_back(GenerateWordTopKSearch(generator, 10));
+		word_weights.push_back(1.0 / (i + 1));
+	}
+	discrete_distribution<int> word_distribution(word_weights.begin(), word_weights.end());
+
+	SearchServer search_server("and with"s);
+	for (int id = 0; id < 50'000; ++id)
+	{
+		search_server.AddDocument(id, GenerateTextTopKSearch(generator, dictionary, word_distribution, uniform_int_distribution(10, 100)(generator)), DocumentStatus::ACTUAL, { uniform_int_distribution(-10, 10)(generator) });
+	}
+	vector<string> queries;
+	for (int i = 0; i < 200; ++i)
+	{
+		queries.push_back(GenerateTextTopKSearch(generator, dictionary, word_distribution, 10));
+	}
+
+	const auto expected = TOP_K_SEARCH_BENCHMARK(execution::seq);
+	const auto found_par = TOP_K_SEARCH_BENCHMARK(execution::par);
+	const auto found_wand = TOP_K_SEARCH_BENCHMARK(BLOCK_MAX_WAND);
+	cout << "Top-K search: "s << CountMismatchesTopKSearch(expected, found_par) << " (par), "s
+		<< CountMismatchesTopKSearch(expected, found_wand) << " (BLOCK_MAX_WAND) of "s << queries.size() << " results differ"s << endl;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "word_counter.h"
+#include <algorithm>
+#include <functional>
+
+WordCounter& WordCounter::ForCurrentThread()
+{
+	thread_local WordCounter counter;
+	return counter;
+}
+
+void WordCounter::Reset(size_t max_word_count)
+{
+	size_t table_size = 16;
+	while (table_size < max_word_count * 2) // At most half full, so probe sequences stay short
+	{
+		table_size *= 2;
+	}
+	table_.assign(table_size, 0); // Keeps the capacity of the previous documents
+	mask_ = table_size - 1;
+	word_counts_.clear();
+}
+
+void WordCounter::Add(std::string_view word)
+{
+	for (size_t cell = std::hash<std::string_view>()(word) & mask_; ; cell = (cell + 1) & mask_)
+	{
+		if (table_[cell] == 0)
+		{
+			word_counts_.push_back({ word, 1 });
+			table_[cell] = static_cast<uint32_t>(word_counts_.size());
+			return;
+		}
+		WordCount& word_count = word_counts_[table_[cell] - 1];
+		if (word_count.word == word)
+		{
+			++word_count.count;
+			return;
+		}
+	}
+}
+
+size_t WordCounter::GetDistinctCount() const
+{
+	return word_counts_.size();
+}
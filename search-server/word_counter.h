@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Scratchpad for counting the words of one document: an open addressing hash table over the distinct words,
+// which are kept in the order of their first occurrence. The memory is reused, so counting a document allocates nothing
+class WordCounter
+{
+public:
+	static WordCounter& ForCurrentThread(); // Reused by all documents of the thread
+
+	void Reset(size_t max_word_count); // Forgets the previous document, at most max_word_count distinct words may be added
+	void Add(std::string_view word); // The word is not copied, its text must outlive the counting
+	size_t GetDistinctCount() const;
+
+	template <typename Function>
+	void ForEach(Function function) const; // Calls function(word, count) for the distinct words in the order of their first occurrence
+
+private:
+	struct WordCount
+	{
+		std::string_view word;
+		uint32_t count;
+	};
+
+	std::vector<WordCount> word_counts_;
+	std::vector<uint32_t> table_; // Index in word_counts_ plus one, 0 for an empty cell
+	size_t mask_ = 0; // The table size is a power of two, a hash is reduced to a cell by this mask
+};
+
+template <typename Function>
+void WordCounter::ForEach(Function function) const
+{
+	for (const WordCount& word_count : word_counts_)
+	{
+		function(word_count.word, word_count.count);
+	}
+}